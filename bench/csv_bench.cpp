@@ -0,0 +1,175 @@
+#include "CsvFile.hpp"
+#include "CsvGenerator.hpp"
+#include "CsvReport.hpp"
+#include "CsvStats.hpp"
+#include "OptionParser.hpp"
+#include "TextUtility.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+// Micro-benchmarks of the main stages of a comparison, on a generated file
+// pair. Each stage is run several times and the fastest run is reported.
+
+static double BestTime(const size_t repeat, const std::function<void()>& fun) {
+    // Fastest of repeated runs, in seconds.
+    double best = 0.0;
+    for (size_t i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fun();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (i == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+static void ShowResult(const std::string& name, const double& seconds, const double& items, const char* unit, const double& bytes=0.0) {
+    char buf[256];
+    if (bytes > 0.0) {
+        snprintf(buf, sizeof(buf), "%-32s : %10.3f ms %14.0f %s/s %10.1f MB/s"
+            , name.c_str(), seconds * 1e3, items / seconds, unit, bytes / seconds / 1e6);
+    } else {
+        snprintf(buf, sizeof(buf), "%-32s : %10.3f ms %14.0f %s/s"
+            , name.c_str(), seconds * 1e3, items / seconds, unit);
+    }
+    std::cout << buf << "\n";
+}
+
+static size_t FileSize(const std::string& filename) {
+    struct stat st;
+    return ::stat(filename.c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+int main(int argc, char** argv) {
+    std::unique_ptr<OptionParser> opts;
+    opts = std::make_unique<OptionParser>(argc, argv);
+
+    CsvGenerator generator;
+    size_t rows = 200000;
+    size_t columns = 20;
+    if (opts->HasValue("--rows")) {
+        rows = opts->GetInteger("--rows");
+    }
+    if (opts->HasValue("--columns")) {
+        columns = opts->GetInteger("--columns");
+    }
+    generator.SetRows(rows);
+    generator.SetColumns(columns);
+    if (opts->HasValue("--nan")) {
+        generator.SetNanDensity(opts->GetDouble("--nan"));
+    }
+    if (opts->HasValue("--noise")) {
+        generator.SetNoise(opts->GetDouble("--noise"));
+    }
+    if (opts->HasValue("--drift")) {
+        generator.SetDrift(opts->GetDouble("--drift"));
+    }
+    if (opts->HasValue("--seed")) {
+        generator.SetSeed(opts->GetInteger("--seed"));
+    }
+
+    if (opts->HasFlag("--generate")) {
+        // Only write a file pair.
+        if (opts->NumParams() != 2) {
+            std::cerr << "Reference and data file names required!\n";
+            return 1;
+        }
+        auto files = opts->GetParams();
+        return generator.Write(files[0], files[1]) ? 0 : 1;
+    }
+
+    size_t repeat = 5;
+    if (opts->HasValue("--repeat")) {
+        repeat = opts->GetInteger("--repeat");
+    }
+    size_t threads = 1;
+    if (opts->HasValue("--threads")) {
+        int value = opts->GetInteger("--threads");
+        threads = value > 0 ? value : 0;
+    }
+    std::string prefix = "/tmp/csvDiffBench";
+    if (opts->HasValue("--prefix")) {
+        prefix = opts->GetString("--prefix");
+    }
+    const std::string ref_filename = prefix + "_ref.csv";
+    const std::string data_filename = prefix + "_data.csv";
+    if (! generator.Write(ref_filename, data_filename)) {
+        return 1;
+    }
+    const double bytes = static_cast<double>(FileSize(ref_filename));
+    std::cout << "Rows: " << rows << ", columns: " << columns << ", " << bytes / 1e6 << " MB per file\n\n";
+
+    // Parsing: header, tokenizing and conversion of all lines.
+    double seconds = BestTime(repeat, [&]{
+        CsvFile file(ref_filename);
+        file.SetThreads(threads);
+        file.Parse();
+    });
+    ShowResult("CsvFile::Parse", seconds, rows, "rows", bytes);
+
+    // Statistics of every column pair.
+    CsvFile ref(ref_filename);
+    CsvFile data(data_filename);
+    ref.Parse();
+    data.Parse();
+    auto names = ref.GetColumnNames();
+    seconds = BestTime(repeat, [&]{
+        for (auto & name : names) {
+            CsvStats stats(1e-8);
+            stats.SetReferenceColumn(ref.GetColumn(name));
+            stats.SetDataColumn(data.GetColumn(name));
+            stats.Calculate();
+        }
+    });
+    ShowResult("CsvStats::Calculate", seconds, static_cast<double>(rows) * names.size(), "values", 2.0 * sizeof(double) * rows * names.size());
+
+    // Name matching: every reference name against every data name.
+    std::vector<std::string> ref_names, data_names;
+    for (size_t c = 0; c < 100; ++c) {
+        ref_names.push_back("solver.output.signal[" + std::to_string(c) + "]");
+        data_names.push_back("Solver_output_signal[" + std::to_string(c) + "]_v2");
+    }
+    size_t total = 0;
+    seconds = BestTime(repeat, [&]{
+        for (auto & r : ref_names) {
+            for (auto & d : data_names) {
+                total += TextUtility::LevenshteinDistance(r, d);
+            }
+        }
+    });
+    ShowResult("TextUtility::LevenshteinDistance", seconds, static_cast<double>(ref_names.size()) * data_names.size(), "pairs");
+
+    // Report lines for many columns, written to a sink instead of the terminal.
+    const size_t report_columns = 10000;
+    seconds = BestTime(repeat, [&]{
+        CsvReport report;
+        report.SetEpsilon(1e-8);
+        report.SetColumnCount(report_columns);
+        report.SetLineCounts(rows, rows);
+        report.Init();
+        for (size_t c = 0; c < report_columns; ++c) {
+            report.SetColumnName(ref_names[c % ref_names.size()]);
+            report.SetMinMaxValues(0.0, 1e-3 * c);
+            report.SetNormalValues(1e-6 * c, 1e-7, 1e-14);
+            report.SetAbsValues(2e-6 * c, 1e-7, 1e-14);
+            report.WriteVariableStats();
+        }
+        std::ostringstream sink;
+        auto buffer = std::cout.rdbuf(sink.rdbuf());
+        report.Show();
+        std::cout.rdbuf(buffer);
+    });
+    ShowResult("CsvReport formatting", seconds, report_columns, "columns");
+
+    // Keep the distance sum alive.
+    return total == 0 ? 1 : 0;
+}
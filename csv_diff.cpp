@@ -1,21 +1,80 @@
 #include "CsvFile.hpp"
 #include "CsvDiff.hpp"
+#include "CsvBatch.hpp"
+#include "CsvDirDiff.hpp"
+#include "CsvProfiler.hpp"
 #include "OptionParser.hpp"
 #include "git.hpp"
 
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <new>
 
-int main(int argc, char** argv) {
-    std::cout << "CsvDiff, Version: " << GitVersion::Describe() << '\n';
+#ifdef CSVDIFF_COUNT_ALLOCATIONS
+// Count allocations for --profile; otherwise the same as the default. All
+// replaceable forms of C++14 are replaced, so new and delete stay matched.
+static void* CountedAlloc(std::size_t size) noexcept {
+    CsvProfiler::CountAllocation();
+    return std::malloc(size > 0 ? size : 1);
+}
+static void* CountedNew(std::size_t size) {
+    if (void* p = CountedAlloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size) {
+    return CountedNew(size);
+}
+void* operator new[](std::size_t size) {
+    return CountedNew(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+#endif
 
+int main(int argc, char** argv) {
     // Parse command line options
     std::unique_ptr<OptionParser> opts;
     opts = std::make_unique<OptionParser>(argc, argv);
 
-    // Two input files are required
-    if (opts->NumParams() != 2) {
-        std::cerr << "Two input parameters (files) required!\n";
+    // Report format; other than text, standard output holds the report only
+    std::string format = "text";
+    if (opts->HasValue("--format")) {
+        format = opts->GetString("--format");
+    }
+    (format == "text" ? std::cout : std::cerr) << "CsvDiff, Version: " << GitVersion::Describe() << '\n';
+    if (! CsvReport::IsFormat(format)) {
+        std::cerr << "Unknown report format: " << format << "\n";
+        return 1;
+    }
+
+    // A reference and at least one data file are required, unless pairs come from a manifest
+    if (opts->NumParams() < 2 && ! opts->HasValue("--manifest")) {
+        std::cerr << "At least two input parameters (files) required!\n";
         return 1;
     }
     // Default value for epsilon.
@@ -55,27 +114,179 @@ int main(int argc, char** argv) {
         brief_mode = true;
     }
 
-    // Read CsvFile instances from input files
+    bool streaming = false;
+    if (opts->HasFlag("--stream") || opts->HasFlag("-s")) {
+        streaming = true;
+    }
+
+    bool gate = false;
+    if (opts->HasFlag("--gate")) {
+        gate = true;
+    }
+
+    // Seconds between reports while the data file is being written, if followed
+    double watch = 0.0;
+    if (opts->HasValue("--watch")) {
+        watch = opts->GetDouble("--watch");
+    } else if (opts->HasFlag("--watch")) {
+        watch = 2.0;
+    }
+
+    // Number of worker threads, 0 for one per hardware thread.
+    size_t threads = 1;
+    if (opts->HasValue("--threads")) {
+        int value = opts->GetInteger("--threads");
+        threads = value > 0 ? value : 0;
+    }
+
+    bool use_cache = false;
+    if (opts->HasFlag("--cache")) {
+        use_cache = true;
+    }
+
+    // Bytes of parsed values kept in memory at a time, 0 for no limit
+    size_t memory_limit = 0;
+    if (opts->HasValue("--memory-limit") && ! opts->GetByteSize("--memory-limit", memory_limit)) {
+        std::cerr << "Memory limit must be a size in bytes, with an optional K, M or G suffix!\n";
+        return 1;
+    }
+
+    // Percentiles of absolute differences, shown per column
+    std::vector<double> percentiles;
+    if (opts->HasValue("--percentiles")) {
+        bool ok = opts->GetDoubleList("--percentiles", percentiles);
+        for (auto p : percentiles) {
+            ok = ok && p >= 0.0 && p <= 100.0;
+        }
+        if (! ok) {
+            std::cerr << "Percentiles must be comma separated numbers in 0..100!\n";
+            return 1;
+        }
+    }
+
+    // Phase timings, shown after the report
+    if (opts->HasFlag("--profile") || opts->HasValue("--profile-json")) {
+        CsvProfiler::Instance().Enable();
+    }
+    auto finish = [&](const int status) {
+        if (opts->HasFlag("--profile")) {
+            CsvProfiler::Instance().Show();
+        }
+        if (opts->HasValue("--profile-json")) {
+            CsvProfiler::Instance().WriteJson(opts->GetString("--profile-json"));
+        }
+        return status;
+    };
+
+    // Comparison settings, shared by all data files
+    auto make_compare = [&]() {
+        auto compare = std::make_unique<CsvDiff>();
+        compare->SetEpsilon(eps);
+        compare->SetHideSame(hide_same);
+        compare->SetHideNan(hide_nan);
+        compare->SetMatchColumns(match_columns);
+        compare->SetUseDataNames(use_data_names);
+        compare->SetGroupByResult(group_by_result);
+        if (brief_mode) {
+            compare->SetBriefMode();
+        }
+        compare->SetStreaming(streaming);
+        compare->SetGate(gate);
+        compare->SetWatch(watch);
+        compare->SetFormat(format);
+        compare->SetThreads(threads);
+        if (opts->HasValue("--columns")) {
+            compare->SetColumnFilter(opts->GetString("--columns"));
+        }
+        if (opts->HasValue("--top")) {
+            int value = opts->GetInteger("--top");
+            compare->SetTopRows(value > 0 ? value : 0);
+        }
+        compare->SetPercentiles(percentiles);
+        compare->SetMemoryLimit(memory_limit);
+        if (opts->HasValue("--key")) {
+            compare->SetKeyColumn(opts->GetString("--key"));
+        }
+        if (opts->HasValue("--key-tol")) {
+            compare->SetKeyTolerance(opts->GetDouble("--key-tol"));
+        }
+        return compare;
+    };
+
     auto files = opts->GetParams();
+    if (gate && (files.size() != 2 || opts->HasValue("--manifest") || CsvDirDiff::IsDirectory(files[0]))) {
+        std::cerr << "Gate mode compares two files only!\n";
+        return CsvDiff::kError;
+    }
+    if (gate && (opts->HasValue("--key") || opts->HasValue("--key-tol"))) {
+        std::cerr << "Gate mode pairs rows by index; --key is not supported!\n";
+        return CsvDiff::kError;
+    }
+    if (watch > 0.0 && (gate || files.size() != 2 || opts->HasValue("--manifest") || CsvDirDiff::IsDirectory(files[0]))) {
+        std::cerr << "Watch mode compares two files only, without --gate!\n";
+        return 1;
+    }
+    if (memory_limit > 0 && (files.size() != 2 || opts->HasValue("--manifest") || CsvDirDiff::IsDirectory(files[0]))) {
+        std::cerr << "Memory limit is used when comparing two files only!\n";
+        return 1;
+    }
+    if (format != "text" && (gate || files.size() != 2 || opts->HasValue("--manifest") || CsvDirDiff::IsDirectory(files[0]))) {
+        std::cerr << "Report formats other than text compare two files only, without --gate!\n";
+        return 1;
+    }
+    if (opts->HasValue("--manifest") || (files.size() == 2 && CsvDirDiff::IsDirectory(files[0]) && CsvDirDiff::IsDirectory(files[1]))) {
+        // Compare all file pairs of two directory trees, or of a manifest
+        CsvDirDiff dir_diff(make_compare);
+        bool ok;
+        if (opts->HasValue("--manifest")) {
+            ok = dir_diff.SetManifest(opts->GetString("--manifest"));
+        } else {
+            ok = dir_diff.SetDirectories(files[0], files[1]);
+        }
+        if (! ok) {
+            return 1;
+        }
+        dir_diff.SetCache(use_cache);
+        dir_diff.SetThreads(threads);
+        {
+            CsvProfiler::Scope phase("run");
+            dir_diff.Run();
+        }
+        dir_diff.ShowReport();
+        return finish(dir_diff.GetStatus());
+    }
+    if (files.size() > 2) {
+        // Compare the reference against each data file
+        CsvBatch batch(make_compare);
+        batch.SetRefFile(files[0]);
+        for (size_t i = 1; i < files.size(); ++i) {
+            batch.AddDataFile(files[i]);
+        }
+        batch.SetCache(use_cache);
+        batch.SetThreads(threads);
+        {
+            CsvProfiler::Scope phase("run");
+            batch.Run();
+        }
+        batch.ShowReport();
+        return finish(batch.GetStatus());
+    }
+
+    // Read CsvFile instances from input files
     auto refFile = std::make_shared<CsvFile>(files[0]);
     auto dataFile = std::make_shared<CsvFile>(files[1]);
+    refFile->SetCache(use_cache);
 
     // Compare the two files
-    auto compare = std::make_unique<CsvDiff>();
-    compare->SetEpsilon(eps);
-    compare->SetHideSame(hide_same);
-    compare->SetHideNan(hide_nan);
-    compare->SetMatchColumns(match_columns);
-    compare->SetUseDataNames(use_data_names);
-    compare->SetGroupByResult(group_by_result);
-    if (brief_mode) {
-        compare->SetBriefMode();
-    }
+    auto compare = make_compare();
     compare->SetRefFile(refFile);
     compare->SetDataFile(dataFile);
-    compare->Run();
+    {
+        CsvProfiler::Scope phase("run");
+        compare->Run();
+    }
     // Show the report
     compare->ShowReport();
 
-    return 0;
-}
\ No newline at end of file
+    return finish(compare->GetStatus());
+}
@@ -0,0 +1,113 @@
+#ifndef BINARY_REPORT_WRITER_HPP
+#define BINARY_REPORT_WRITER_HPP
+
+#include "ReportWriter.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Compact binary records in host byte order, read until end of file.
+//
+// Layout: Header, the requested percentiles (double each), key and join
+// method names; then per column a Record, the name bytes, the absolute
+// differences at the percentiles (double each) and top_count TopRecords,
+// with rows counted from 1 after the header.
+class BinaryReportWriter : public ReportWriter {
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        double eps;
+        uint64_t columns;
+        uint64_t ref_lines;
+        uint64_t data_lines;
+        uint64_t compared;
+        uint64_t same;
+        uint64_t nan;
+        // Rows paired on a key column; zero counts and no key if not.
+        uint64_t matched;
+        uint64_t ref_unmatched;
+        uint64_t data_unmatched;
+        uint32_t percentile_count;
+        uint32_t top_rows;
+        uint32_t key_length;
+        uint32_t join_method_length;
+    };
+    struct Record {
+        uint32_t status;
+        uint32_t name_length;
+        double values[6];
+        uint32_t top_count;
+        uint32_t reserved;
+    };
+    struct TopRecord {
+        uint64_t row;
+        uint64_t data_row;
+        double ref;
+        double data;
+        double diff_abs;
+    };
+    static const uint32_t kVersion = 2;
+    static const uint32_t kByteOrder = 0x01020304;
+    size_t percentile_count_;
+
+public:
+    BinaryReportWriter(std::ostream& out)
+    : ReportWriter(out)
+    , percentile_count_(0)
+    {}
+    ~BinaryReportWriter() {}
+    void Begin(const CsvResultTotals& totals) override {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "CSVDIFFR", 8);
+        header.version = kVersion;
+        header.byte_order = kByteOrder;
+        header.eps = totals.eps;
+        header.columns = totals.columns;
+        header.ref_lines = totals.ref_lines;
+        header.data_lines = totals.data_lines;
+        header.compared = totals.compared;
+        header.same = totals.same;
+        header.nan = totals.nan;
+        header.matched = totals.matched;
+        header.ref_unmatched = totals.ref_unmatched;
+        header.data_unmatched = totals.data_unmatched;
+        percentile_count_ = totals.percentiles.size();
+        header.percentile_count = static_cast<uint32_t>(percentile_count_);
+        header.top_rows = static_cast<uint32_t>(totals.top_rows);
+        header.key_length = static_cast<uint32_t>(totals.key.size());
+        header.join_method_length = static_cast<uint32_t>(totals.key.empty() ? 0 : totals.join_method.size());
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out_.write(reinterpret_cast<const char*>(totals.percentiles.data()), totals.percentiles.size() * sizeof(double));
+        out_.write(totals.key.data(), header.key_length);
+        out_.write(totals.join_method.data(), header.join_method_length);
+    }
+    void Write(const CsvResult& result) override {
+        Record record;
+        std::memset(&record, 0, sizeof(record));
+        record.status = static_cast<uint32_t>(result.status);
+        record.name_length = static_cast<uint32_t>(result.name.size());
+        record.values[0] = result.max;
+        record.values[1] = result.min;
+        record.values[2] = result.mean;
+        record.values[3] = result.sd;
+        record.values[4] = result.mean_abs;
+        record.values[5] = result.sd_abs;
+        record.top_count = static_cast<uint32_t>(result.top.size());
+        out_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        out_.write(result.name.data(), result.name.size());
+        for (size_t i = 0; i < percentile_count_; ++i) {
+            double value = i < result.percentiles.size() ? result.percentiles[i] : std::numeric_limits<double>::quiet_NaN();
+            out_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        for (auto & row : result.top) {
+            TopRecord top = { row.row + 1, row.data_row + 1, row.ref, row.data, row.diff_abs };
+            out_.write(reinterpret_cast<const char*>(&top), sizeof(top));
+        }
+    }
+};
+
+#endif // BINARY_REPORT_WRITER_HPP
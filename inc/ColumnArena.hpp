@@ -0,0 +1,49 @@
+#ifndef COLUMN_ARENA_HPP
+#define COLUMN_ARENA_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+// Single allocation holding all column values of a file, column after column.
+class ColumnArena {
+private:
+    std::unique_ptr<double[]> data_;
+    size_t columns_;
+    size_t capacity_;
+
+public:
+    ColumnArena()
+    : columns_(0)
+    , capacity_(0)
+    {}
+    ~ColumnArena() {}
+    void Allocate(const size_t columns, const size_t capacity) {
+        // Values are left uninitialized; columns track how many are written.
+        data_.reset(new double[columns * capacity]);
+        columns_ = columns;
+        capacity_ = capacity;
+    }
+    void Grow(const size_t capacity) {
+        // Move to a larger allocation, column by column; pointers into the
+        // old one are invalid afterwards.
+        std::unique_ptr<double[]> data(new double[columns_ * capacity]);
+        for (size_t c = 0; c < columns_; ++c) {
+            std::memcpy(data.get() + c * capacity, data_.get() + c * capacity_, capacity_ * sizeof(double));
+        }
+        data_.swap(data);
+        capacity_ = capacity;
+    }
+    void Release() {
+        data_.reset();
+        columns_ = capacity_ = 0;
+    }
+    size_t GetCapacity() const {
+        return capacity_;
+    }
+    double* GetColumn(const size_t index) {
+        return data_.get() + index * capacity_;
+    }
+};
+
+#endif // COLUMN_ARENA_HPP
@@ -0,0 +1,50 @@
+#ifndef COLUMN_FILTER_HPP
+#define COLUMN_FILTER_HPP
+
+#include <regex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Column selection from a comma separated list. Each entry is matched
+// exactly against the column name, or else as a regular expression.
+class ColumnFilter {
+private:
+    std::unordered_set<std::string> names_;
+    std::vector<std::regex> patterns_;
+
+public:
+    ColumnFilter(const std::string& spec) {
+        size_t begin = 0;
+        while (begin <= spec.size()) {
+            size_t end = spec.find(',', begin);
+            if (end == std::string::npos) {
+                end = spec.size();
+            }
+            std::string entry = spec.substr(begin, end - begin);
+            if (! entry.empty()) {
+                names_.insert(entry);
+                try {
+                    patterns_.emplace_back(entry);
+                } catch (const std::regex_error&) {
+                    // Not a valid expression; used as a plain name only.
+                }
+            }
+            begin = end + 1;
+        }
+    }
+    ~ColumnFilter() {}
+    bool Matches(const std::string& name) const {
+        if (names_.count(name) > 0) {
+            return true;
+        }
+        for (auto & pattern : patterns_) {
+            if (std::regex_match(name, pattern)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif // COLUMN_FILTER_HPP
@@ -0,0 +1,225 @@
+#ifndef COLUMN_MATCHER_HPP
+#define COLUMN_MATCHER_HPP
+
+#include "TextUtility.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Finds the closest data name (Levenshtein distance) for each reference
+// name. Ties go to the smaller length difference, then to the earlier data
+// name. Instead of computing every distance, candidates are pruned by a
+// lower bound from their length and the character pairs (bigrams) they
+// share with the reference name, then checked with a distance bounded by the
+// best match so far. Reference names are matched in parallel.
+class ColumnMatcher {
+private:
+    struct Posting {
+        uint32_t index;
+        uint32_t count;
+    };
+    struct Candidate {
+        int distance;
+        int length_diff;
+        size_t index;
+        bool operator<(const Candidate& other) const {
+            if (distance != other.distance) {
+                return distance < other.distance;
+            }
+            if (length_diff != other.length_diff) {
+                return length_diff < other.length_diff;
+            }
+            return index < other.index;
+        }
+    };
+    // Working memory of one worker.
+    struct Scratch {
+        std::vector<uint32_t> shared;
+        std::vector<uint32_t> touched;
+        uint64_t peq[256];
+    };
+    // Reference names per task.
+    static const size_t kBatchSize = 64;
+
+    const std::vector<std::string>& data_;
+    std::unordered_map<std::string, size_t> exact_;
+    // Data names by bigram; frequent bigrams are not listed, they count
+    // as shared with every name instead, which keeps the bound valid.
+    std::vector<std::vector<Posting>> postings_;
+    std::vector<char> frequent_;
+    // Data names by length.
+    std::vector<std::vector<uint32_t>> by_length_;
+    size_t threads_;
+
+public:
+    ColumnMatcher(const std::vector<std::string>& data)
+    : data_(data)
+    , postings_(1 << 16)
+    , frequent_(1 << 16, 0)
+    , threads_(1)
+    {
+        BuildIndex();
+    }
+    ~ColumnMatcher() {}
+    void SetThreads(const size_t threads) {
+        threads_ = threads;
+    }
+    std::vector<long> Match(const std::vector<std::string>& ref) {
+        // Index of the closest data name for each reference name, -1 if none.
+        std::vector<long> result(ref.size(), -1);
+        const size_t batches = (ref.size() + kBatchSize - 1) / kBatchSize;
+        auto run_batch = [&](const size_t batch) {
+            Scratch scratch;
+            scratch.shared.assign(data_.size(), 0);
+            size_t end = std::min(ref.size(), (batch + 1) * kBatchSize);
+            for (size_t i = batch * kBatchSize; i < end; ++i) {
+                result[i] = FindClosest(ref[i], scratch);
+            }
+        };
+        if (threads_ == 1 || batches < 2) {
+            for (size_t batch = 0; batch < batches; ++batch) {
+                run_batch(batch);
+            }
+        } else {
+            ThreadPool pool(threads_);
+            pool.ParallelFor(batches, run_batch);
+        }
+        return result;
+    }
+
+private:
+    static void GetBigrams(const std::string& name, std::vector<std::pair<uint16_t, uint32_t>>& grams) {
+        // Distinct bigrams of a name, with the number of times each occurs.
+        std::vector<uint16_t> all;
+        for (size_t i = 1; i < name.size(); ++i) {
+            all.push_back(static_cast<uint16_t>(static_cast<unsigned char>(name[i - 1]) << 8 | static_cast<unsigned char>(name[i])));
+        }
+        std::sort(all.begin(), all.end());
+        grams.clear();
+        for (auto gram : all) {
+            if (! grams.empty() && grams.back().first == gram) {
+                ++grams.back().second;
+            } else {
+                grams.push_back(std::make_pair(gram, 1u));
+            }
+        }
+    }
+    void BuildIndex() {
+        std::vector<std::pair<uint16_t, uint32_t>> grams;
+        for (size_t j = 0; j < data_.size(); ++j) {
+            exact_.emplace(data_[j], j);
+            GetBigrams(data_[j], grams);
+            for (auto & gram : grams) {
+                postings_[gram.first].push_back(Posting{ static_cast<uint32_t>(j), gram.second });
+            }
+            if (by_length_.size() <= data_[j].size()) {
+                by_length_.resize(data_[j].size() + 1);
+            }
+            by_length_[data_[j].size()].push_back(static_cast<uint32_t>(j));
+        }
+        // Bigrams in most names cost much to count and prune little.
+        const size_t limit = std::max<size_t>(64, data_.size() / 16);
+        for (size_t g = 0; g < postings_.size(); ++g) {
+            if (postings_[g].size() > limit) {
+                frequent_[g] = 1;
+                std::vector<Posting>().swap(postings_[g]);
+            }
+        }
+    }
+    static int LowerBound(const int l1, const int l2, const int shared) {
+        // Length difference, and the q-gram lemma for q = 2: names within
+        // distance k share at least max(l1, l2) - 1 - 2k bigrams.
+        int bound = std::abs(l1 - l2);
+        int missing = std::max(l1, l2) - 1 - shared;
+        return std::max(bound, missing > 0 ? (missing + 1) / 2 : 0);
+    }
+    int Distance(const std::string& name, const std::string& data, const Scratch& scratch, const int limit) const {
+        if (name.size() <= TextUtility::kMaxPatternLength) {
+            return TextUtility::MyersDistance(scratch.peq, name.size(), data, limit);
+        }
+        return TextUtility::LevenshteinDistance(name, data, limit);
+    }
+    void Check(const std::string& name, const size_t j, const int bound, const Scratch& scratch, Candidate& best) const {
+        // Replace best with data name j if it is closer.
+        const int length_diff = std::abs(static_cast<int>(name.size()) - static_cast<int>(data_[j].size()));
+        Candidate lower = { bound, length_diff, j };
+        if (! (lower < best)) {
+            return;
+        }
+        int limit = best.distance == INT_MAX ? INT_MAX - 1 : best.distance;
+        Candidate candidate = { Distance(name, data_[j], scratch, limit), length_diff, j };
+        if (candidate < best) {
+            best = candidate;
+        }
+    }
+    long FindClosest(const std::string& name, Scratch& scratch) const {
+        if (data_.empty()) {
+            return -1;
+        }
+        auto exact = exact_.find(name);
+        if (exact != exact_.end()) {
+            return static_cast<long>(exact->second);
+        }
+        if (name.size() <= TextUtility::kMaxPatternLength) {
+            TextUtility::SetPattern(name, scratch.peq);
+        }
+        // Count bigrams shared with each data name.
+        std::vector<std::pair<uint16_t, uint32_t>> grams;
+        GetBigrams(name, grams);
+        int frequent = 0;
+        scratch.touched.clear();
+        for (auto & gram : grams) {
+            if (frequent_[gram.first]) {
+                frequent += gram.second;
+                continue;
+            }
+            for (auto & posting : postings_[gram.first]) {
+                if (scratch.shared[posting.index] == 0) {
+                    scratch.touched.push_back(posting.index);
+                }
+                scratch.shared[posting.index] += std::min(gram.second, posting.count);
+            }
+        }
+        const int length = static_cast<int>(name.size());
+        Candidate best = { INT_MAX, INT_MAX, data_.size() };
+        // Start with the name sharing most bigrams, for a tight bound early.
+        if (! scratch.touched.empty()) {
+            uint32_t seed = scratch.touched[0];
+            for (auto j : scratch.touched) {
+                if (scratch.shared[j] > scratch.shared[seed] || (scratch.shared[j] == scratch.shared[seed] && j < seed)) {
+                    seed = j;
+                }
+            }
+            Check(name, seed, 0, scratch, best);
+        }
+        for (auto j : scratch.touched) {
+            int bound = LowerBound(length, static_cast<int>(data_[j].size()), scratch.shared[j] + frequent);
+            if (bound <= best.distance) {
+                Check(name, j, bound, scratch, best);
+            }
+        }
+        // Names sharing no counted bigram, by length while the bound allows.
+        for (size_t l = 0; l < by_length_.size(); ++l) {
+            int bound = LowerBound(length, static_cast<int>(l), frequent);
+            if (by_length_[l].empty() || bound > best.distance) {
+                continue;
+            }
+            for (auto j : by_length_[l]) {
+                if (scratch.shared[j] == 0) {
+                    Check(name, j, bound, scratch, best);
+                }
+            }
+        }
+        for (auto j : scratch.touched) {
+            scratch.shared[j] = 0;
+        }
+        return static_cast<long>(best.index);
+    }
+};
+
+#endif // COLUMN_MATCHER_HPP
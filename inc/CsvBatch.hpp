@@ -0,0 +1,93 @@
+#ifndef CSV_BATCH_HPP
+#define CSV_BATCH_HPP
+
+#include "CsvFile.hpp"
+#include "CsvDiff.hpp"
+#include "CsvSummary.hpp"
+#include "ThreadPool.hpp"
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Compares one reference file against several data files. The reference is
+// read once and shared by all comparisons; data files are compared in
+// parallel, one per worker, and released as soon as their report is done.
+class CsvBatch {
+public:
+    typedef std::function<std::unique_ptr<CsvDiff>()> DiffFactory;
+
+private:
+    DiffFactory make_diff_;
+    std::string ref_filename_;
+    std::vector<std::string> data_filenames_;
+    std::vector<std::unique_ptr<CsvDiff>> diffs_;
+    CsvFilePtr ref_;
+    CsvSummary summary_;
+    bool use_cache_;
+    size_t threads_;
+
+public:
+    CsvBatch(DiffFactory make_diff)
+    : make_diff_(make_diff)
+    , use_cache_(false)
+    , threads_(1)
+    {}
+    ~CsvBatch() {}
+    void SetRefFile(const std::string& filename) {
+        ref_filename_ = filename;
+    }
+    void AddDataFile(const std::string& filename) {
+        data_filenames_.push_back(filename);
+    }
+    void SetCache(const bool use_cache) {
+        use_cache_ = use_cache;
+    }
+    void SetThreads(const size_t threads) {
+        threads_ = threads;
+    }
+    void Run() {
+        // Parse the reference once, with all columns, before any comparison uses it.
+        ref_ = std::make_shared<CsvFile>(ref_filename_);
+        ref_->SetCache(use_cache_);
+        ref_->SetThreads(threads_);
+        ref_->Parse();
+
+        diffs_.clear();
+        for (size_t i = 0; i < data_filenames_.size(); ++i) {
+            diffs_.push_back(make_diff_());
+        }
+        ThreadPool pool(threads_);
+        pool.ParallelFor(data_filenames_.size(), [this](const size_t i) {
+            auto& diff = diffs_[i];
+            // Parallelism is across data files; each comparison runs serially.
+            diff->SetStreaming(false);
+            diff->SetThreads(1);
+            diff->SetRefFile(ref_);
+            diff->SetDataFile(std::make_shared<CsvFile>(data_filenames_[i]));
+            diff->Run();
+            // Release the data columns, only the report is kept.
+            diff->SetDataFile(nullptr);
+        });
+        summary_ = CsvSummary();
+        for (size_t i = 0; i < diffs_.size(); ++i) {
+            summary_.Add(data_filenames_[i], diffs_[i]->GetReport());
+        }
+    }
+    int GetStatus() const {
+        // Exit status over all data files, see CsvSummary::GetExitStatus.
+        return summary_.GetExitStatus();
+    }
+    void ShowReport() {
+        // Show the report of each data file in turn, then a summary of all.
+        for (size_t i = 0; i < diffs_.size(); ++i) {
+            std::cout << "\n== Data file: " << data_filenames_[i] << " ==\n";
+            diffs_[i]->ShowReport();
+        }
+        summary_.Show("Ref: " + ref_filename_);
+    }
+};
+
+#endif // CSV_BATCH_HPP
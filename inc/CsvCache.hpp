@@ -0,0 +1,222 @@
+#ifndef CSV_CACHE_HPP
+#define CSV_CACHE_HPP
+
+#include "MappedFile.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary columnar sidecar of a parsed CSV file (<file>.cache). It is used
+// instead of the text only if size, mtime and content hash of the source
+// still match; column values are read in place from the mapped cache.
+//
+// Layout: Header, column names (u32 length + bytes each, padded to 8),
+// u64 value count per column, then the values of each column in turn.
+class CsvCache {
+public:
+    struct Source {
+        uint64_t size;
+        int64_t mtime;
+        uint64_t hash;
+    };
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint64_t source_hash;
+        uint64_t columns;
+        uint64_t lines;
+        uint64_t names_size;
+    };
+    static const uint32_t kVersion = 1;
+    static const uint32_t kByteOrder = 0x01020304;
+
+    std::string path_;
+    MappedFile file_;
+    std::vector<std::string> names_;
+    std::vector<const double*> values_;
+    std::vector<uint64_t> sizes_;
+    uint64_t lines_;
+
+public:
+    CsvCache(const std::string& source_filename)
+    : path_(source_filename + ".cache")
+    , file_(path_)
+    , lines_(0)
+    {}
+    ~CsvCache() {}
+    static bool GetSource(const std::string& filename, Source& source) {
+        // Identify the source file by size, modification time and contents.
+        struct stat st;
+        if (::stat(filename.c_str(), &st) != 0) {
+            return false;
+        }
+        MappedFile file(filename);
+        if (! file.Open()) {
+            return false;
+        }
+        source.size = file.Size();
+        source.mtime = static_cast<int64_t>(st.st_mtime);
+        source.hash = Hash(file.Begin(), file.Size());
+        return true;
+    }
+    bool Load(const Source& source) {
+        // Map the cache and check it belongs to this version of the source.
+        if (! file_.Open()) {
+            return false;
+        }
+        const char* pos = file_.Begin();
+        const char* end = file_.End();
+        Header header;
+        if (! Take(pos, end, &header, sizeof(header))
+            || std::memcmp(header.magic, "CSVDIFFC", 8) != 0
+            || header.version != kVersion
+            || header.byte_order != kByteOrder
+            || header.source_size != source.size
+            || header.source_mtime != source.mtime
+            || header.source_hash != source.hash
+            || header.names_size > static_cast<uint64_t>(end - pos)) {
+            return Fail();
+        }
+        const char* names_end = pos + header.names_size;
+        names_.clear();
+        for (uint64_t c = 0; c < header.columns; ++c) {
+            uint32_t length;
+            if (! Take(pos, names_end, &length, sizeof(length)) || length > static_cast<uint64_t>(names_end - pos)) {
+                return Fail();
+            }
+            names_.push_back(std::string(pos, length));
+            pos += length;
+        }
+        pos = names_end;
+        sizes_.assign(header.columns, 0);
+        if (header.columns > 0 && ! Take(pos, end, sizes_.data(), header.columns * sizeof(uint64_t))) {
+            return Fail();
+        }
+        values_.clear();
+        for (uint64_t c = 0; c < header.columns; ++c) {
+            if (sizes_[c] > static_cast<uint64_t>(end - pos) / sizeof(double)) {
+                return Fail();
+            }
+            values_.push_back(reinterpret_cast<const double*>(pos));
+            pos += sizes_[c] * sizeof(double);
+        }
+        lines_ = header.lines;
+        return true;
+    }
+    const std::vector<std::string>& GetColumnNames() const {
+        return names_;
+    }
+    size_t GetNumberOfLines() const {
+        return lines_;
+    }
+    const double* GetValues(const size_t column) const {
+        return values_[column];
+    }
+    size_t GetSize(const size_t column) const {
+        return sizes_[column];
+    }
+    template <typename Column>
+    bool Write(const Source& source, const std::vector<Column>& columns, const size_t lines) {
+        // Write to a temporary file first, so readers never see a partial cache.
+        // Its name is unique per process and call, as pairs sharing a
+        // reference file may write the same cache on several threads.
+        static std::atomic<unsigned long> serial(0);
+        std::string tmp_path = path_ + "." + std::to_string(getpid()) + "." + std::to_string(serial++) + ".tmp";
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (! out.good()) {
+            return false;
+        }
+        std::string names;
+        for (auto & col : columns) {
+            uint32_t length = static_cast<uint32_t>(col.GetName().size());
+            names.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            names.append(col.GetName());
+        }
+        names.resize((names.size() + 7) / 8 * 8, '\0');
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "CSVDIFFC", 8);
+        header.version = kVersion;
+        header.byte_order = kByteOrder;
+        header.source_size = source.size;
+        header.source_mtime = source.mtime;
+        header.source_hash = source.hash;
+        header.columns = columns.size();
+        header.lines = lines;
+        header.names_size = names.size();
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(names.data(), names.size());
+        for (auto & col : columns) {
+            uint64_t size = col.GetSize();
+            out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        }
+        for (auto & col : columns) {
+            out.write(reinterpret_cast<const char*>(col.GetData()), col.GetSize() * sizeof(double));
+        }
+        out.close();
+        if (! out.good() || std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+    const std::string& GetPath() const {
+        return path_;
+    }
+
+private:
+    bool Fail() {
+        file_.Close();
+        return false;
+    }
+    static bool Take(const char*& pos, const char* end, void* out, const size_t size) {
+        if (static_cast<size_t>(end - pos) < size) {
+            return false;
+        }
+        std::memcpy(out, pos, size);
+        pos += size;
+        return true;
+    }
+    static uint64_t Mix(uint64_t h, const uint64_t word) {
+        h ^= word;
+        h *= 0xff51afd7ed558ccdULL;
+        return h ^ (h >> 32);
+    }
+    static uint64_t Hash(const char* data, const size_t size) {
+        // Content hash over 8 byte words, in 4 independent lanes for speed.
+        uint64_t lanes[4] = {
+            0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL,
+            0x165667b19e3779f9ULL, 0x27d4eb2f165667c5ULL
+        };
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            for (int l = 0; l < 4; ++l) {
+                uint64_t word;
+                std::memcpy(&word, data + i + 8 * l, sizeof(word));
+                lanes[l] = Mix(lanes[l], word);
+            }
+        }
+        uint64_t h = Mix(lanes[0], size);
+        for (int l = 1; l < 4; ++l) {
+            h = Mix(h, lanes[l]);
+        }
+        for (; i < size; ++i) {
+            h = Mix(h, static_cast<unsigned char>(data[i]));
+        }
+        return h;
+    }
+};
+
+#endif // CSV_CACHE_HPP
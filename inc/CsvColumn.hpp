@@ -3,21 +3,22 @@
 
 #include <iostream>
 #include <string>
-#include <vector>
-#include <memory>
 
 class CsvColumn {
 private:
     // Csv header name
     std::string name_;
     std::string name_history_;
-    // Csv column values
-    std::vector<double> values_;
+    // Csv column values, a span in the arena of the file
+    double* values_;
+    size_t size_;
 
 public:
     CsvColumn(const std::string& name)
     : name_(name)
     , name_history_(name)
+    , values_(nullptr)
+    , size_(0)
     {}
     ~CsvColumn() {}
     void SetName(const std::string& name) {
@@ -31,25 +32,34 @@ public:
         return name_history_;
     }
     const size_t GetSize() const {
-        return values_.size();
+        return size_;
     }
     const double& GetValue(const size_t index) const {
         return values_[index];
     }
+    const double* GetData() const {
+        return values_;
+    }
+    void SetStorage(double* values, const size_t size=0) {
+        // Attach column to its span; values up to size are already in place.
+        values_ = values;
+        size_ = size;
+    }
     void AddValue(const double& value) {
-        // Add new value to the column.
-        values_.push_back(value);
+        // Add new value to the column; span is sized for all lines of the file.
+        values_[size_++] = value;
     }
     void Dump() {
         // Dump all values in the column, /w name at the top.
         std::cout << "Column: " << name_ << " [ ";
-        for (auto& value : values_) {
-            std::cout << value << " ";
+        for (size_t i = 0; i < size_; ++i) {
+            std::cout << values_[i] << " ";
         }
         std::cout << "]\n";
     }
 };
 
-typedef std::shared_ptr<CsvColumn> CsvColumnPtr;
+// Columns are owned by their CsvFile.
+typedef CsvColumn* CsvColumnPtr;
 
 #endif // CSV_COLUMN_HPP
@@ -1,22 +1,39 @@
 #ifndef CSV_DIFF_HPP
 #define CSV_DIFF_HPP
 
+#include "ColumnArena.hpp"
+#include "ColumnFilter.hpp"
+#include "ColumnMatcher.hpp"
 #include "CsvFile.hpp"
+#include "CsvProfiler.hpp"
 #include "CsvStats.hpp"
 #include "CsvReport.hpp"
+#include "RowJoin.hpp"
 #include "TextUtility.hpp"
+#include "ThreadPool.hpp"
 
 #include <vector>
 #include <string>
 #include <limits>
 #include <cmath>
+#include <csignal>
 #include <cstdio>
 #include <algorithm>
+#include <chrono>
 #include <map>
+#include <thread>
 
 typedef std::map<std::string, std::string> ColumnNameMap;
 
 class CsvDiff {
+public:
+    // Result of a run; non-zero values are used as the exit status.
+    enum Status {
+        kPassed = 0,
+        kError = 1,
+        kFailed = 2
+    };
+
 private:
     double eps_;
     bool match_;
@@ -25,6 +42,26 @@ private:
     bool use_data_names_;
     bool group_by_result_;
     bool brief_;
+    std::string format_;
+    bool streaming_;
+    bool gate_;
+    // Seconds between reports while following a data file; zero if not.
+    double watch_interval_;
+    Status status_;
+    size_t threads_;
+    size_t top_rows_;
+    // Bytes of parsed values to stay within, by comparing columns in batches; zero if unlimited.
+    size_t memory_limit_;
+    std::vector<double> percentiles_;
+    std::unique_ptr<ColumnFilter> filter_;
+    // Rows are aligned on the key column if set; aligned copies of the
+    // compared columns live in their own arenas.
+    std::string key_;
+    double key_tolerance_;
+    RowJoin join_;
+    ColumnArena ref_aligned_;
+    ColumnArena data_aligned_;
+    std::vector<CsvColumn> aligned_columns_;
     CsvFilePtr ref_;
     CsvFilePtr data_;
     std::unique_ptr<CsvReport> report_;
@@ -37,6 +74,15 @@ public:
         hide_nan_ = false;
         group_by_result_ = false;
         brief_ = false;
+        format_ = "text";
+        streaming_ = false;
+        gate_ = false;
+        watch_interval_ = 0.0;
+        status_ = kPassed;
+        threads_ = 1;
+        top_rows_ = 0;
+        memory_limit_ = 0;
+        key_tolerance_ = 0.0;
     }
     ~CsvDiff() {}
     void SetEpsilon(const double& eps) {
@@ -57,6 +103,24 @@ public:
     void SetGroupByResult(const bool group) {
         group_by_result_ = group;
     }
+    void SetWatch(const double interval) {
+        watch_interval_ = interval;
+    }
+    void SetFormat(const std::string& format) {
+        format_ = format;
+    }
+    void SetGate(const bool gate) {
+        gate_ = gate;
+    }
+    Status GetStatus() const {
+        return status_;
+    }
+    void SetKeyColumn(const std::string& name) {
+        key_ = name;
+    }
+    void SetKeyTolerance(const double& tolerance) {
+        key_tolerance_ = tolerance;
+    }
     void SetRefFile(CsvFilePtr ref) {
         ref_ = ref;
     }
@@ -66,23 +130,516 @@ public:
     void SetBriefMode() {
         brief_ = true;
     }
+    void SetStreaming(const bool streaming) {
+        streaming_ = streaming;
+    }
+    void SetThreads(const size_t threads) {
+        threads_ = threads;
+    }
+    void SetTopRows(const size_t count) {
+        // Rows with largest differences shown per column.
+        top_rows_ = count;
+    }
+    void SetMemoryLimit(const size_t bytes) {
+        memory_limit_ = bytes;
+    }
+    void SetPercentiles(const std::vector<double>& percentiles) {
+        // Percentiles (0..100) of absolute differences shown per column.
+        percentiles_ = percentiles;
+    }
+    void SetColumnFilter(const std::string& spec) {
+        // Compare only reference columns selected by names or regular expressions.
+        filter_ = std::make_unique<ColumnFilter>(spec);
+    }
     void Run() {
-        size_t ref_line_count, data_line_count;
-        if (ref_) {
-            // Parse if reference file is set.
+        if (gate_) {
+            RunGate();
+            return;
+        }
+        if (watch_interval_ > 0.0) {
+            RunWatch();
+            return;
+        }
+        if (streaming_) {
+            RunStreaming();
+            return;
+        }
+        if (! ref_ || ! data_) {
+            std::cerr << "Reference and data files must be set!\n";
+            return;
+        }
+        // Decide compared columns from the headers, then parse only those.
+        {
+            CsvProfiler::Scope phase("header");
+            ref_->ParseHeader();
+            data_->ParseHeader();
+        }
+
+        CreateReport();
+
+        ColumnNameList column_names;
+        {
+            CsvProfiler::Scope phase("columns");
+            column_names = ComparedColumns();
+        }
+        if (memory_limit_ > 0 && column_names.size() > 1 && ! ref_->IsParsed()) {
+            if (DecompressStream::IsPipe(ref_->GetFilename()) || DecompressStream::IsPipe(data_->GetFilename())) {
+                std::cerr << "Memory limit is not used for piped input; files are read once.\n";
+            } else {
+                CompareInBatches(column_names);
+                ReleaseAligned();
+                return;
+            }
+        }
+        CompareColumns(column_names);
+        // Only the report is kept once files are compared.
+        ReleaseAligned();
+    }
+    void CompareInBatches(const ColumnNameList& column_names) {
+        // Parse and compare a batch of columns at a time, so parsed columns
+        // stay within the memory limit; both files are read once per batch.
+        // The first batch has one column, and gives the memory per column.
+        // The cache holds all columns, so it is not used.
+        ref_->SetCache(false);
+        size_t batch_size = 1;
+        for (size_t begin = 0; begin < column_names.size(); ) {
+            size_t end = std::min(column_names.size(), begin + batch_size);
+            if (begin > 0) {
+                ReleaseAligned();
+                ref_->Release();
+                data_->Release();
+            }
+            if (! CompareColumns(ColumnNameList(column_names.begin() + begin, column_names.begin() + end))) {
+                return;
+            }
+            if (begin == 0) {
+                batch_size = GetBatchSize();
+            }
+            begin = end;
+        }
+    }
+    size_t GetBatchSize() const {
+        // Columns per batch within the memory limit, from the values per
+        // column of the parsed files and of their aligned copies.
+        const size_t file_bytes = sizeof(double) * (ref_->GetCapacity() + data_->GetCapacity());
+        size_t column_bytes = file_bytes;
+        size_t budget = memory_limit_;
+        if (! key_.empty()) {
+            column_bytes += 2 * sizeof(double) * join_.GetMatchCount();
+            budget = budget > file_bytes ? budget - file_bytes : 0;
+        }
+        return std::max<size_t>(1, budget / std::max<size_t>(1, column_bytes));
+    }
+    bool CompareColumns(const ColumnNameList& column_names) {
+        // Parse the given columns, with the key column if any, and add their
+        // statistics to the report in column order.
+        auto parsed_names = column_names;
+        if (! key_.empty() && std::find(parsed_names.begin(), parsed_names.end(), key_) == parsed_names.end()) {
+            parsed_names.push_back(key_);
+        }
+        ref_->SetProjection(parsed_names);
+        data_->SetProjection(parsed_names);
+        if (! ref_->IsParsed()) {
+            ref_->SetThreads(threads_);
             ref_->Parse();
-            ref_line_count = ref_->GetNumberOfLines();
-        } else {
-            std::cerr << "No reference file set!\n";
         }
-        if (data_) {
-            // Parse if data file is set.
-            data_->Parse();
-            data_line_count = data_->GetNumberOfLines();
+        data_->SetThreads(threads_);
+        data_->Parse();
+        if (! CheckInput()) {
+            return false;
+        }
+        report_->SetLineCounts(ref_->GetNumberOfLines(), data_->GetNumberOfLines());
+
+        std::vector<CsvColumnPtr> ref_columns, data_columns;
+        for (auto & name : column_names) {
+            ref_columns.push_back(ref_->GetColumn(name));
+            data_columns.push_back(data_->GetColumn(name));
+        }
+        if (! key_.empty()) {
+            CsvProfiler::Scope phase("align");
+            if (! AlignRows(ref_columns, data_columns)) {
+                return false;
+            }
+            phase.SetRows(join_.GetMatchCount());
+        }
+        // Columns, and chunks of rows in a column, are independent; calculate
+        // them in parallel if requested and merge the partial results in order.
+        std::vector<CsvStatPtr> stats(column_names.size());
+        size_t values = 0;
+        for (size_t i = 0; i < column_names.size(); ++i) {
+            if (ref_columns[i] && data_columns[i]) {
+                stats[i] = GetStats(ref_columns[i], data_columns[i]);
+                values += std::min(ref_columns[i]->GetSize(), data_columns[i]->GetSize());
+            }
+        }
+        {
+            CsvProfiler::Scope phase("statistics");
+            phase.SetBytes(2 * sizeof(double) * values);
+            CalculateStats(stats);
+        }
+        // Report in column order, independent of completion order.
+        CsvProfiler::Scope phase("report");
+        for (size_t i = 0; i < column_names.size(); ++i) {
+            if (stats[i]) {
+                // If both columns are found, write statistics into a report line.
+                AddVariableStats(stats[i], key_.empty() ? nullptr : &join_);
+            } else {
+                std::cerr << "Column: " << column_names[i] << " not found!\n";
+            }
+        }
+        return true;
+    }
+    void CalculateStats(std::vector<CsvStatPtr>& stats) {
+        if (threads_ != 1) {
+            std::vector<std::pair<CsvStatPtr, size_t>> chunks;
+            for (auto & column_stats : stats) {
+                if (column_stats) {
+                    column_stats->Prepare();
+                    for (size_t c = 0; c < column_stats->GetNumberOfChunks(); ++c) {
+                        chunks.push_back(std::make_pair(column_stats, c));
+                    }
+                }
+            }
+            ThreadPool pool(threads_);
+            pool.ParallelFor(chunks.size(), [&chunks](size_t i){
+                chunks[i].first->CalculateChunk(chunks[i].second);
+            });
+            for (auto & column_stats : stats) {
+                if (column_stats) {
+                    column_stats->Combine();
+                }
+            }
         } else {
-            std::cerr << "No data file set!\n";
+            for (auto & column_stats : stats) {
+                if (column_stats) {
+                    column_stats->Calculate();
+                }
+            }
+        }
+    }
+    void RunStreaming() {
+        // Read both files row by row in lockstep, accumulating statistics per column.
+        if (! ref_ || ! data_) {
+            std::cerr << "Reference and data files must be set!\n";
+            return;
+        }
+        if (! key_.empty()) {
+            std::cerr << "Key column is not used in streaming mode; rows are paired by index.\n";
+        }
+        ref_->ParseHeader();
+        data_->ParseHeader();
+
+        CreateReport();
+
+        // Resolve compared columns to their positions in each row.
+        std::vector<CsvStatPtr> stats;
+        std::vector<size_t> ref_index, data_index;
+        auto column_names = ComparedColumns();
+        ref_->SetProjection(column_names);
+        data_->SetProjection(column_names);
+        for (auto & name : column_names) {
+            int ri = ref_->GetColumnIndex(name);
+            int di = data_->GetColumnIndex(name);
+            if (ri >= 0 && di >= 0) {
+                stats.push_back(CreateStats(name));
+                ref_index.push_back(ri);
+                data_index.push_back(di);
+            } else {
+                std::cerr << "Column: " << name << " not found!\n";
+            }
+        }
+
+        CsvProfiler::Scope phase("stream");
+        std::vector<double> ref_row, data_row;
+        size_t ref_count, data_count;
+        bool has_ref = ref_->ReadRow(ref_row, ref_count);
+        bool has_data = data_->ReadRow(data_row, data_count);
+        while (has_ref && has_data) {
+            for (size_t i = 0; i < stats.size(); ++i) {
+                if (ref_index[i] < ref_count && data_index[i] < data_count) {
+                    stats[i]->Add(ref_row[ref_index[i]], data_row[data_index[i]]);
+                }
+            }
+            has_ref = ref_->ReadRow(ref_row, ref_count);
+            has_data = data_->ReadRow(data_row, data_count);
+        }
+        // Only count the rest of the longer file.
+        while (has_ref) {
+            has_ref = ref_->ReadRow(ref_row, ref_count);
+        }
+        while (has_data) {
+            has_data = data_->ReadRow(data_row, data_count);
+        }
+        report_->SetLineCounts(ref_->GetNumberOfLines(), data_->GetNumberOfLines());
+        phase.SetRows(ref_->GetNumberOfLines());
+        if (! CheckInput()) {
+            return;
+        }
+
+        for (auto & column_stats : stats) {
+            column_stats->Finish();
+            AddVariableStats(column_stats);
+        }
+    }
+    void RunWatch() {
+        // Compare a data file while it is being written. Rows appended since
+        // the last poll are added to statistics kept over the whole run, and
+        // a report of the rows so far is shown every interval. Ends when the
+        // data file has as many rows as the reference file, or on SIGINT.
+        if (! ref_ || ! data_) {
+            std::cerr << "Reference and data files must be set!\n";
+            return;
+        }
+        if (DecompressStream::IsStream(data_->GetFilename())) {
+            std::cerr << "Watch mode needs an uncompressed, regular data file!\n";
+            return;
+        }
+        if (! key_.empty()) {
+            std::cerr << "Key column is not used in watch mode; rows are paired by index.\n";
         }
-       
+        CsvProfiler::Scope phase("watch");
+        const std::chrono::milliseconds poll(100);
+        WatchInterrupted() = 0;
+        auto previous_handler = std::signal(SIGINT, OnWatchInterrupt);
+        ref_->ParseHeader();
+        data_->SetFollow(true);
+        data_->ParseHeader();
+        while (! data_->HasHeader() && ! WatchInterrupted()) {
+            std::this_thread::sleep_for(poll);
+            data_->ParseHeader();
+        }
+        if (data_->GetNumberOfColumns() == 0) {
+            std::signal(SIGINT, previous_handler);
+            std::cerr << "No header in " << data_->GetFilename() << "\n";
+            return;
+        }
+
+        CreateReport();
+
+        std::vector<CsvStatPtr> stats;
+        std::vector<CsvColumnPtr> ref_columns;
+        std::vector<size_t> data_index;
+        auto column_names = ComparedColumns();
+        ref_->SetProjection(column_names);
+        data_->SetProjection(column_names);
+        if (! ref_->IsParsed()) {
+            ref_->SetThreads(threads_);
+            ref_->Parse();
+        }
+        if (! CheckInput()) {
+            std::signal(SIGINT, previous_handler);
+            return;
+        }
+        for (auto & name : column_names) {
+            auto ref_column = ref_->GetColumn(name);
+            int di = data_->GetColumnIndex(name);
+            if (ref_column && di >= 0) {
+                stats.push_back(CreateStats(name));
+                ref_columns.push_back(ref_column);
+                data_index.push_back(di);
+            } else {
+                std::cerr << "Column: " << name << " not found!\n";
+            }
+        }
+
+        const size_t ref_lines = ref_->GetNumberOfLines();
+        const auto interval = std::chrono::duration<double>(watch_interval_);
+        auto next_report = std::chrono::steady_clock::now() + interval;
+        std::vector<double> data_row;
+        size_t data_count;
+        size_t rows = 0;
+        size_t reported_rows = 0;
+        while (rows < ref_lines && ! WatchInterrupted()) {
+            // Only complete rows appended since the last poll are read.
+            while (rows < ref_lines && data_->ReadRow(data_row, data_count)) {
+                for (size_t i = 0; i < stats.size(); ++i) {
+                    if (data_index[i] < data_count && rows < ref_columns[i]->GetSize()) {
+                        stats[i]->Add(ref_columns[i]->GetData()[rows], data_row[data_index[i]]);
+                    }
+                }
+                ++rows;
+            }
+            if (rows >= ref_lines) {
+                break;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_report) {
+                if (rows > reported_rows) {
+                    ShowWatchReport(stats, rows, ref_lines);
+                    reported_rows = rows;
+                }
+                next_report = now + interval;
+            }
+            std::this_thread::sleep_for(poll);
+        }
+        std::signal(SIGINT, previous_handler);
+        report_->SetLineCounts(ref_lines, rows);
+        phase.SetRows(rows);
+
+        for (auto & column_stats : stats) {
+            column_stats->Finish();
+            AddVariableStats(column_stats);
+        }
+    }
+    void RunGate() {
+        // Read both files row by row and stop at the first value pair which
+        // differs by eps or more; no statistics are calculated.
+        status_ = kError;
+        if (! ref_ || ! data_) {
+            std::cerr << "Reference and data files must be set!\n";
+            return;
+        }
+        ref_->ParseHeader();
+        data_->ParseHeader();
+
+        CreateReport();
+
+        std::vector<std::string> names;
+        std::vector<size_t> ref_index, data_index;
+        auto column_names = ComparedColumns();
+        ref_->SetProjection(column_names);
+        data_->SetProjection(column_names);
+        for (auto & name : column_names) {
+            int ri = ref_->GetColumnIndex(name);
+            int di = data_->GetColumnIndex(name);
+            if (ri >= 0 && di >= 0) {
+                names.push_back(use_data_names_ ? data_->GetColumn(name)->GetNameHistory() : name);
+                ref_index.push_back(ri);
+                data_index.push_back(di);
+            } else {
+                std::cerr << "Column: " << name << " not found!\n";
+            }
+        }
+        if (names.empty()) {
+            report_->SetGateError("no columns to compare");
+            return;
+        }
+
+        status_ = kFailed;
+        CsvProfiler::Scope phase("gate");
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        std::vector<double> ref_row, data_row;
+        size_t ref_count, data_count;
+        size_t row = 0;
+        bool has_ref = ref_->ReadRow(ref_row, ref_count);
+        bool has_data = data_->ReadRow(data_row, data_count);
+        while (has_ref && has_data) {
+            ++row;
+            for (size_t i = 0; i < names.size(); ++i) {
+                // Missing fields compare as NaN.
+                double ref_value = ref_index[i] < ref_count ? ref_row[ref_index[i]] : nan;
+                double data_value = data_index[i] < data_count ? data_row[data_index[i]] : nan;
+                if (! WithinTolerance(ref_value, data_value)) {
+                    phase.SetRows(row);
+                    if (! CheckInput()) {
+                        // The row may be cut short by the end of the input.
+                        report_->SetGateError("input could not be read to its end");
+                        return;
+                    }
+                    report_->SetGateViolation(names[i], row, ref_value, data_value);
+                    return;
+                }
+            }
+            has_ref = ref_->ReadRow(ref_row, ref_count);
+            has_data = data_->ReadRow(data_row, data_count);
+        }
+        phase.SetRows(row);
+        if (! CheckInput()) {
+            report_->SetGateError("input could not be read to its end");
+            return;
+        }
+        if (has_ref || has_data) {
+            report_->SetGateRowViolation(row + 1, has_ref);
+            return;
+        }
+        report_->SetGatePassed(row, names.size());
+        status_ = kPassed;
+    }
+    bool CheckInput() {
+        // Corrupt or truncated compressed input ends early; nothing is
+        // reported on the part which was read.
+        bool ok = true;
+        for (auto & file : { ref_, data_ }) {
+            if (file->HasReadError()) {
+                std::cerr << "Incomplete input: " << file->GetFilename() << "\n";
+                ok = false;
+            }
+        }
+        if (! ok) {
+            status_ = kError;
+        }
+        return ok;
+    }
+    bool WithinTolerance(const double& ref_value, const double& data_value) const {
+        // Same test as the statistics: NaN on both sides is equal, NaN on one
+        // side is a difference.
+        if (std::isnan(ref_value) && std::isnan(data_value)) {
+            return true;
+        }
+        return std::fabs(ref_value - data_value) < eps_;
+    }
+    bool AlignRows(std::vector<CsvColumnPtr>& ref_columns, std::vector<CsvColumnPtr>& data_columns) {
+        // Pair rows on the key column, then replace compared columns with
+        // copies holding matched rows only, in reference row order.
+        CsvColumnPtr ref_key = ref_->GetColumn(key_);
+        CsvColumnPtr data_key = data_->GetColumn(key_);
+        if (! ref_key || ! data_key) {
+            std::cerr << "Key column: " << key_ << " not found!\n";
+            return false;
+        }
+        join_.Join(ref_key->GetData(), ref_key->GetSize(), data_key->GetData(), data_key->GetSize(), key_tolerance_);
+        const size_t matched = join_.GetMatchCount();
+        ref_aligned_.Allocate(ref_columns.size(), matched);
+        data_aligned_.Allocate(data_columns.size(), matched);
+        aligned_columns_.clear();
+        aligned_columns_.reserve(2 * ref_columns.size());
+        for (size_t i = 0; i < ref_columns.size(); ++i) {
+            if (! ref_columns[i] || ! data_columns[i]) {
+                continue;
+            }
+            ref_columns[i] = AlignColumn(*ref_columns[i], ref_aligned_.GetColumn(i), false);
+            data_columns[i] = AlignColumn(*data_columns[i], data_aligned_.GetColumn(i), true);
+        }
+        report_->SetAlignment(key_, join_.GetMethodName(), matched
+            , join_.GetUnmatchedRefCount(), join_.GetUnmatchedDataCount());
+        return true;
+    }
+    void ReleaseAligned() {
+        aligned_columns_.clear();
+        ref_aligned_.Release();
+        data_aligned_.Release();
+        join_.Clear();
+    }
+    CsvColumnPtr AlignColumn(const CsvColumn& column, double* values, const bool data) {
+        join_.Gather(column.GetData(), column.GetSize(), values, data);
+        aligned_columns_.push_back(column);
+        aligned_columns_.back().SetStorage(values, join_.GetMatchCount());
+        return &aligned_columns_.back();
+    }
+    static volatile std::sig_atomic_t& WatchInterrupted() {
+        static volatile std::sig_atomic_t interrupted = 0;
+        return interrupted;
+    }
+    static void OnWatchInterrupt(int) {
+        WatchInterrupted() = 1;
+    }
+    void ShowWatchReport(const std::vector<CsvStatPtr>& stats, const size_t rows, const size_t ref_lines) {
+        // Report of the rows read so far; statistics are finished on copies,
+        // so accumulation continues unchanged.
+        auto report = std::move(report_);
+        CreateReport();
+        report_->SetLineCounts(rows, rows);
+        for (auto & column_stats : stats) {
+            auto snapshot = std::make_shared<CsvStats>(*column_stats);
+            snapshot->Finish();
+            AddVariableStats(snapshot);
+        }
+        std::cout << "\n== Watch; " << rows << " of " << ref_lines << " rows ==\n";
+        report_->Show();
+        std::cout.flush();
+        report_ = std::move(report);
+    }
+    void CreateReport() {
         report_ = std::make_unique<CsvReport>();
         // Set epsilon value for report.
         report_->SetEpsilon(eps_);
@@ -91,30 +648,28 @@ public:
         if (brief_) {
             report_->SetBriefMode();
         }
-        report_->SetLineCounts(ref_line_count, data_line_count);
         report_->SetGroupByResult(group_by_result_);
+        report_->SetFormat(format_);
+        report_->SetPercentiles(percentiles_);
+        report_->SetTopRowCount(top_rows_);
         report_->SetColumnCount(ref_->GetNumberOfColumns());
         report_->Init();
-
-        // Get names for columns with matching names in both input files.
-        ColumnNameList column_names;
-        if (match_) {
-            // TODO : implement
-            column_names = MatchingColumns();
-        } else {
-            column_names = CommonColumns();
-        }
-        for (auto & name : column_names) {
-            auto ref_column = ref_->GetColumn(name);
-            auto data_column = data_->GetColumn(name);
-            if (ref_column && data_column) {
-                // If both columns are found, calculate statistics into a report line.
-                auto stats = GetStats(ref_column, data_column);
-                AddVariableStats(stats);
-            } else {
-                std::cerr << "Column: " << name << " not found!\n";
+    }
+    ColumnNameList ComparedColumns() {
+        // Get names for columns with matching names in both input files,
+        // reduced to the selected ones if a column filter is set.
+        auto column_names = match_ ? MatchingColumns() : CommonColumns();
+        if (filter_) {
+            ColumnNameList selected;
+            for (auto & name : column_names) {
+                if (filter_->Matches(name)) {
+                    selected.push_back(name);
+                }
             }
+            column_names.swap(selected);
+            report_->SetColumnCount(column_names.size());
         }
+        return column_names;
     }
     ColumnNameList CommonColumns() {
         // Return common names from both input files.
@@ -131,7 +686,6 @@ public:
         return common_names;
     }
     ColumnNameList MatchingColumns() {
-        // TODO : Consider cases where levenshtein distance is same for multiple columns.
         // Return auto-matched names from both input files.
         auto ref_column_names = ref_->GetColumnNames();
         auto data_column_names = data_->GetColumnNames();
@@ -149,15 +703,28 @@ public:
         }
         auto matching_names = FindMatchingColumns(list_ref, list_data);
         for (auto & match : matching_names) {
-            auto data_column = data_->GetColumn(strip_data[match.second]);
-            data_column->SetName(strip_ref[match.first]);
+            data_->RenameColumn(strip_data[match.second], strip_ref[match.first]);
         }
         return ref_column_names;
     }
 
+    CsvStatPtr CreateStats(const std::string& name) {
+        // Statistics for a column whose values are added row by row.
+        auto stats = std::make_shared<CsvStats>(eps_);
+        stats->SetTopRows(top_rows_);
+        stats->SetQuantiles(! percentiles_.empty());
+        if (use_data_names_) {
+            stats->SetColumnName(data_->GetColumn(name)->GetNameHistory());
+        } else {
+            stats->SetColumnName(name);
+        }
+        return stats;
+    }
     CsvStatPtr GetStats(CsvColumnPtr ref_column, CsvColumnPtr data_column) {
-        // Calculate statistics for a single column.
+        // Statistics for a single column, calculated by the caller.
         auto stats = std::make_unique<CsvStats>(eps_);
+        stats->SetTopRows(top_rows_);
+        stats->SetQuantiles(! percentiles_.empty());
         if (use_data_names_) {
             stats->SetColumnName(data_column->GetNameHistory());
         } else {
@@ -165,10 +732,9 @@ public:
         }
         stats->SetReferenceColumn(ref_column);
         stats->SetDataColumn(data_column);
-        stats->Calculate();
         return stats;
     }
-    void AddVariableStats(CsvStatPtr stats) {
+    void AddVariableStats(CsvStatPtr stats, const RowJoin* join = nullptr) {
         if (! stats->Ready()) {
             return;
         }
@@ -187,41 +753,55 @@ public:
         stats->GetStatAbs(mean_abs, sd_abs, var_abs);
         report_->SetAbsValues(mean_abs, sd_abs, var_abs);
 
+        std::vector<double> percentile_values;
+        for (auto p : percentiles_) {
+            percentile_values.push_back(stats->GetQuantile(p / 100.0));
+        }
+        report_->SetPercentileValues(percentile_values);
+        // Rows of aligned columns are matches; report the rows of both files.
+        std::vector<TopRows::Row> top_rows = stats->GetTopRows();
+        if (join) {
+            for (auto & row : top_rows) {
+                row.data_row = join->GetDataRow(row.row);
+                row.row = join->GetRefRow(row.row);
+            }
+        }
+        report_->SetTopRows(std::move(top_rows));
+
         report_->WriteVariableStats();
     }
     ColumnNameMap FindMatchingColumns(const ColumnNameList& ref, const ColumnNameList& data) {
+        // Closest data name of each reference name; on equal distance the one
+        // closest in length, then the first one in the data file.
         ColumnNameMap result;
-        for (auto & r_name : ref) {
-            int d_min = 1000;
-            int d;
-            std::string d_match = "";
-            for (auto & d_name : data) {
-                d = TextUtility::LevenshteinDistance(r_name, d_name);
-                if (d < d_min) {
-                    d_min = d;
-                    d_match = d_name;
-                }
-            }
-            result[r_name] = d_match;
+        ColumnMatcher matcher(data);
+        matcher.SetThreads(threads_);
+        auto matches = matcher.Match(ref);
+        for (size_t i = 0; i < ref.size(); ++i) {
+            result[ref[i]] = matches[i] < 0 ? "" : data[matches[i]];
         }
         return result;
     }
     void ReportNonMatchingColumns(const ColumnNameList& common, const ColumnNameList& ref, const ColumnNameList& data) {
-        ColumnNameList work_ref = ref;
-        ColumnNameList work_data = data;
-        for (auto & name : common) {
-            // Remove common names from the lists.
-            work_ref.erase(std::remove(work_ref.begin(), work_ref.end(), name), work_ref.end());
-            work_data.erase(std::remove(work_data.begin(), work_data.end(), name), work_data.end());
-        }
+        // Remove common names from the lists; all of them are sorted.
+        auto is_common = [&common](const std::string& name) {
+            return std::binary_search(common.begin(), common.end(), name);
+        };
+        ColumnNameList work_ref, work_data;
+        std::remove_copy_if(ref.begin(), ref.end(), back_inserter(work_ref), is_common);
+        std::remove_copy_if(data.begin(), data.end(), back_inserter(work_data), is_common);
         auto matching_names = FindMatchingColumns(work_ref, work_data);
         for (auto & match : matching_names) {
             report_->ColumnMatchingSuggestion(match.first, match.second);
         }
     }
     void ShowReport() {
+        CsvProfiler::Scope phase("output");
         report_->Show();
     }
+    const CsvReport& GetReport() const {
+        return *report_;
+    }
 };
 
 #endif // CSV_DIFF_HPP
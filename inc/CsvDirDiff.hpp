@@ -0,0 +1,236 @@
+#ifndef CSV_DIR_DIFF_HPP
+#define CSV_DIR_DIFF_HPP
+
+#include "CsvFile.hpp"
+#include "CsvDiff.hpp"
+#include "CsvSummary.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Compares many file pairs in one run: the .csv files of two directory
+// trees paired by relative path, or the pairs listed in a manifest. Pairs
+// are run largest first on the work-stealing pool, so big files start early
+// and small ones fill the gaps at the end, instead of a big one straggling.
+class CsvDirDiff {
+public:
+    typedef std::function<std::unique_ptr<CsvDiff>()> DiffFactory;
+
+private:
+    struct Pair {
+        std::string name;
+        std::string ref_filename;
+        std::string data_filename;
+        size_t size;
+        bool missing;
+        std::unique_ptr<CsvDiff> diff;
+    };
+    DiffFactory make_diff_;
+    std::vector<Pair> pairs_;
+    std::string title_;
+    CsvSummary summary_;
+    bool use_cache_;
+    size_t threads_;
+
+public:
+    CsvDirDiff(DiffFactory make_diff)
+    : make_diff_(make_diff)
+    , use_cache_(false)
+    , threads_(1)
+    {}
+    ~CsvDirDiff() {}
+    static bool IsDirectory(const std::string& path) {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    void SetCache(const bool use_cache) {
+        use_cache_ = use_cache;
+    }
+    void SetThreads(const size_t threads) {
+        threads_ = threads;
+    }
+    bool SetDirectories(const std::string& ref_dir, const std::string& data_dir) {
+        // Pair files of both trees by their path relative to the tree root.
+        std::vector<std::string> ref_files;
+        std::vector<std::string> data_files;
+        if (! ListFiles(ref_dir, "", ref_files) || ! ListFiles(data_dir, "", data_files)) {
+            return false;
+        }
+        std::map<std::string, int> sides;
+        for (auto & name : ref_files) {
+            sides[name] |= 1;
+        }
+        for (auto & name : data_files) {
+            sides[name] |= 2;
+        }
+        pairs_.clear();
+        for (auto & side : sides) {
+            AddPair(side.first, ref_dir + "/" + side.first, data_dir + "/" + side.first, side.second != 3);
+        }
+        title_ = "Ref: " + ref_dir + ", Data: " + data_dir;
+        return true;
+    }
+    bool SetManifest(const std::string& manifest) {
+        // One pair per line, reference then data file, separated by a comma or blanks.
+        std::ifstream in(manifest);
+        if (! in.good()) {
+            std::cerr << "Unable to open manifest " << manifest << "\n";
+            return false;
+        }
+        pairs_.clear();
+        std::string line;
+        size_t line_number = 0;
+        while (std::getline(in, line)) {
+            ++line_number;
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::vector<std::string> fields;
+            std::string field;
+            for (char c : line + " ") {
+                if (std::isspace(static_cast<unsigned char>(c))) {
+                    if (! field.empty()) {
+                        fields.push_back(field);
+                        field.clear();
+                    }
+                } else {
+                    field += c;
+                }
+            }
+            if (fields.empty() || fields[0][0] == '#') {
+                continue;
+            }
+            if (fields.size() != 2) {
+                std::cerr << "Manifest " << manifest << ":" << line_number << ": expected two files\n";
+                continue;
+            }
+            bool missing = ! IsFile(fields[0]) || ! IsFile(fields[1]);
+            AddPair(fields[0] + "," + fields[1], fields[0], fields[1], missing);
+        }
+        title_ = "Manifest: " + manifest;
+        return true;
+    }
+    void Run() {
+        // Largest pairs first; each worker takes the next pair in that order.
+        std::vector<Pair*> jobs;
+        for (auto & pair : pairs_) {
+            if (! pair.missing) {
+                pair.diff = make_diff_();
+                jobs.push_back(&pair);
+            }
+        }
+        std::stable_sort(jobs.begin(), jobs.end(), [](const Pair* a, const Pair* b) {
+            return a->size > b->size;
+        });
+        ThreadPool pool(threads_);
+        pool.ParallelFor(jobs.size(), [this, &jobs](const size_t i) {
+            RunPair(*jobs[i]);
+        });
+        summary_ = CsvSummary();
+        for (auto & pair : pairs_) {
+            if (pair.missing) {
+                summary_.AddMissing(pair.name);
+            } else {
+                summary_.Add(pair.name, pair.diff->GetReport());
+            }
+        }
+    }
+    int GetStatus() const {
+        // Exit status over all pairs, see CsvSummary::GetExitStatus.
+        return summary_.GetExitStatus();
+    }
+    void ShowReport() {
+        // Show the reports of pairs that are not the same, then a summary of all.
+        for (auto & pair : pairs_) {
+            if (! pair.missing && CsvSummary::GetStatus(pair.diff->GetReport()) != CsvSummary::kSame) {
+                std::cout << "\n== Pair: " << pair.name << " ==\n";
+                pair.diff->ShowReport();
+            }
+        }
+        summary_.Show(title_);
+    }
+
+private:
+    void AddPair(const std::string& name, const std::string& ref_filename, const std::string& data_filename, const bool missing) {
+        Pair pair;
+        pair.name = name;
+        pair.ref_filename = ref_filename;
+        pair.data_filename = data_filename;
+        pair.size = missing ? 0 : FileSize(ref_filename) + FileSize(data_filename);
+        pair.missing = missing;
+        pairs_.push_back(std::move(pair));
+    }
+    void RunPair(Pair& pair) {
+        // Parallelism is across pairs; each comparison runs serially.
+        auto ref = std::make_shared<CsvFile>(pair.ref_filename);
+        ref->SetCache(use_cache_);
+        pair.diff->SetThreads(1);
+        pair.diff->SetRefFile(ref);
+        pair.diff->SetDataFile(std::make_shared<CsvFile>(pair.data_filename));
+        pair.diff->Run();
+        // Release the columns, only the report is kept.
+        pair.diff->SetRefFile(nullptr);
+        pair.diff->SetDataFile(nullptr);
+    }
+    static bool IsFile(const std::string& path) {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    }
+    static size_t FileSize(const std::string& path) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0) {
+            return 0;
+        }
+        return static_cast<size_t>(st.st_size);
+    }
+    static bool IsCsvName(const std::string& name) {
+        // Plain or compressed CSV files.
+        for (const char* suffix : { ".csv", ".csv.gz", ".csv.zst" }) {
+            size_t length = std::strlen(suffix);
+            if (name.size() > length && name.compare(name.size() - length, length, suffix) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    static bool ListFiles(const std::string& root, const std::string& prefix, std::vector<std::string>& files) {
+        // Collect CSV files below root recursively, as paths relative to root.
+        std::string path = prefix.empty() ? root : root + "/" + prefix;
+        DIR* dir = ::opendir(path.c_str());
+        if (dir == nullptr) {
+            std::cerr << "Unable to open directory " << path << "\n";
+            return false;
+        }
+        std::vector<std::string> entries;
+        while (struct dirent* entry = ::readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                entries.push_back(name);
+            }
+        }
+        ::closedir(dir);
+        std::sort(entries.begin(), entries.end());
+        bool result = true;
+        for (auto & name : entries) {
+            std::string relative = prefix.empty() ? name : prefix + "/" + name;
+            std::string full = root + "/" + relative;
+            if (IsDirectory(full)) {
+                result = ListFiles(root, relative, files) && result;
+            } else if (IsCsvName(name) && IsFile(full)) {
+                files.push_back(relative);
+            }
+        }
+        return result;
+    }
+};
+
+#endif // CSV_DIR_DIFF_HPP
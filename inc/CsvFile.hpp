@@ -1,44 +1,197 @@
 #ifndef CSV_FILE_HPP
 #define CSV_FILE_HPP
 
+#include "ColumnArena.hpp"
+#include "CsvCache.hpp"
 #include "CsvColumn.hpp"
-#include "TextUtility.hpp"
+#include "CsvProfiler.hpp"
+#include "CsvReader.hpp"
+#include "ThreadPool.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <memory>
-#include <fstream>
+#include <unordered_map>
 #include <vector>
-#include <functional>
 
 typedef std::vector<std::string> ColumnNameList;
 
 class CsvFile {
 private:
     std::string filename_;
-    std::ifstream f_csv_;
-    std::string csv_header_;
-    std::vector<std::string> csv_lines_;
-    std::vector<CsvColumnPtr> csv_columns_;
+    CsvReader f_csv_;
+    std::vector<CsvColumn> csv_columns_;
+    // Column position by name; first column wins for duplicate names.
+    std::unordered_map<std::string, size_t> column_index_;
+    ColumnArena arena_;
+    // Start of each column in the arena, nullptr for columns not parsed.
+    std::vector<double*> storage_;
+    // Columns to parse; all of them if empty.
+    FieldMask projection_;
     size_t number_of_lines_;
     size_t number_of_columns_;
+    bool duplicate_names_;
+    bool header_read_;
+    bool parsed_;
+    // Input could not be read to its end, e.g. truncated compressed data.
+    bool read_error_;
+    bool use_cache_;
+    bool follow_;
+    std::unique_ptr<CsvCache> cache_;
+    size_t threads_;
+    // Smallest chunk worth a thread of its own.
+    static const size_t kMinChunkSize = 1 << 20;
+    // Initial lines per column for input of unknown length.
+    static const size_t kStreamCapacity = 1 << 16;
 
 public:
     CsvFile(const std::string& filename)
     : filename_(filename)
+    , f_csv_(filename)
     , number_of_lines_(0)
     , number_of_columns_(0)
+    , duplicate_names_(false)
+    , header_read_(false)
+    , parsed_(false)
+    , read_error_(false)
+    , use_cache_(false)
+    , follow_(false)
+    , threads_(1)
     {}
     ~CsvFile() {}
     void Parse(const bool dump=false) {
-        Open();
-        // Read CSV lines into column objects.
-        ReadLines();
-        Close();
+        if (parsed_) {
+            // Already parsed, e.g. a reference file shared by several diffs.
+            return;
+        }
+        CsvProfiler::Scope phase("parse " + filename_);
+        if (! header_read_) {
+            ParseHeader();
+        }
+        // Pipes have no identity to validate a cache against.
+        const bool use_cache = use_cache_ && ! DecompressStream::IsPipe(filename_);
+        if (use_cache && LoadCache()) {
+            // Columns are read in place from the binary cache.
+            Close();
+        } else {
+            if (use_cache) {
+                // Cache holds all columns.
+                projection_.clear();
+            }
+            // Read CSV lines into column objects; tokenizing and conversion
+            // of fields are one pass.
+            {
+                CsvProfiler::Scope lines("lines");
+                size_t bytes = f_csv_.IsStream() ? 0 : f_csv_.RemainingBytes();
+                lines.SetBytes(bytes);
+                phase.SetBytes(bytes);
+                ReadLines();
+                lines.SetRows(number_of_lines_);
+            }
+            Close();
+            if (use_cache && ! read_error_) {
+                CsvProfiler::Scope cache("cache write");
+                WriteCache();
+            }
+        }
+        phase.SetRows(number_of_lines_);
+        parsed_ = true;
         if (dump) {
             // If requested, dump column contents.
             DumpColumns();
         }
     }
+    void SetCache(const bool use) {
+        // Keep a binary copy of parsed columns next to the file, and use it
+        // instead of parsing while the file is unchanged.
+        use_cache_ = use;
+    }
+    void SetThreads(const size_t threads) {
+        threads_ = threads;
+    }
+    void SetFollow(const bool follow) {
+        // Read a file still being written with ReadRow(), as lines are completed.
+        follow_ = follow;
+        f_csv_.SetFollow(follow);
+    }
+    bool HasHeader() const {
+        return header_read_;
+    }
+    void Release() {
+        // Free parsed columns and go back to the first data line, so other
+        // columns can be parsed in another pass. Not for pipes.
+        for (auto & col : csv_columns_) {
+            col.SetStorage(nullptr);
+        }
+        storage_.clear();
+        arena_.Release();
+        cache_.reset();
+        number_of_lines_ = 0;
+        parsed_ = false;
+        Close();
+        Open();
+        // Step over the header line.
+        f_csv_.ReadFields([](size_t, const char*, const char*){});
+    }
+    size_t GetCapacity() const {
+        // Values allocated per parsed column.
+        return arena_.GetCapacity();
+    }
+    void ParseHeader() {
+        // Read only the header; data lines are then read by Parse() or ReadRow().
+        if (header_read_) {
+            return;
+        }
+        if (! f_csv_.IsOpen()) {
+            Open();
+        }
+        ReadHeader();
+        // A followed file may not have its header yet; try again later.
+        header_read_ = ! follow_ || number_of_columns_ > 0 || ! f_csv_.IsOpen();
+    }
+    void SetProjection(const ColumnNameList& names) {
+        // Parse only the named columns; other fields are skipped by the tokenizer.
+        if (parsed_) {
+            return;
+        }
+        projection_.assign(csv_columns_.size(), 0);
+        for (auto & name : names) {
+            int index = GetColumnIndex(name);
+            if (index >= 0) {
+                projection_[index] = 1;
+            }
+        }
+    }
+    bool ReadRow(std::vector<double>& values, size_t& count) {
+        // Read next data line into values, without storing it in the columns.
+        count = 0;
+        if (! f_csv_.IsOpen()) {
+            return false;
+        }
+        values.resize(csv_columns_.size());
+        bool found = f_csv_.ReadFields([&values, &count](size_t index, const char* b, const char* e){
+            if (index < values.size()) {
+                values[index] = CsvTokenizer::ToDouble(b, e);
+                count = index + 1;
+            }
+        }, GetProjection());
+        if (found) {
+            ++number_of_lines_;
+        } else if (! follow_) {
+            Close();
+        }
+        return found;
+    }
+    bool IsParsed() const {
+        return parsed_;
+    }
+    bool HasReadError() const {
+        return read_error_ || f_csv_.Failed();
+    }
+    const std::string& GetFilename() const {
+        return filename_;
+    }
     size_t GetNumberOfLines() {
         return number_of_lines_;
     }
@@ -46,12 +199,39 @@ public:
         return number_of_columns_;
     }
     CsvColumnPtr GetColumn(const std::string& name) {
-        for (auto & col : csv_columns_) {
-            if (col->GetName() == name) {
-                return col;
+        int index = GetColumnIndex(name);
+        if (index < 0) {
+            return nullptr;
+        }
+        return &csv_columns_[index];
+    }
+    int GetColumnIndex(const std::string& name) {
+        auto found = column_index_.find(name);
+        if (found == column_index_.end()) {
+            return -1;
+        }
+        return static_cast<int>(found->second);
+    }
+    bool RenameColumn(const std::string& name, const std::string& new_name) {
+        // Rename column, keeping the name lookup in sync.
+        int index = GetColumnIndex(name);
+        if (index < 0) {
+            return false;
+        }
+        csv_columns_[index].SetName(new_name);
+        if (duplicate_names_) {
+            IndexColumns();
+            return true;
+        }
+        column_index_.erase(name);
+        auto inserted = column_index_.emplace(new_name, index);
+        if (! inserted.second) {
+            duplicate_names_ = true;
+            if (static_cast<size_t>(index) < inserted.first->second) {
+                inserted.first->second = index;
             }
         }
-        return nullptr;
+        return true;
     }
     void DumpFilename() {
         std::cout << "CsvFile: " << filename_ << "\n";
@@ -59,72 +239,187 @@ public:
     ColumnNameList GetColumnNames() {
         ColumnNameList result;
         for (auto & col : csv_columns_) {
-            result.push_back(col->GetName());
+            result.push_back(col.GetName());
         }
         return result;
     }
 
 private:
     void Open() {
-        f_csv_ = std::ifstream(filename_);
+        if (! f_csv_.Open()) {
+            std::cerr << "Unable to open " << filename_ << "\n";
+        }
+    }
+    void ReadHeader() {
+        if (f_csv_.IsOpen()) {
+            // First non-empty line is the header; create CsvColumn objects from it.
+            f_csv_.ReadFields([this](size_t, const char* b, const char* e){
+                csv_columns_.emplace_back(std::string(b, e));
+            });
+            number_of_columns_ = csv_columns_.size();
+            IndexColumns();
+        }
+    }
+    void IndexColumns() {
+        column_index_.clear();
+        duplicate_names_ = false;
+        for (size_t i = 0; i < csv_columns_.size(); ++i) {
+            if (! column_index_.emplace(csv_columns_[i].GetName(), i).second) {
+                duplicate_names_ = true;
+            }
+        }
+    }
+    const FieldMask* GetProjection() const {
+        return projection_.empty() ? nullptr : &projection_;
+    }
+    bool IsProjected(const size_t index) const {
+        return projection_.empty() || projection_[index];
+    }
+    void AllocateColumns(const size_t capacity) {
+        // One allocation for all parsed columns, capacity values each.
+        size_t count = 0;
+        for (size_t c = 0; c < csv_columns_.size(); ++c) {
+            count += IsProjected(c) ? 1 : 0;
+        }
+        arena_.Allocate(count, capacity);
+        storage_.assign(csv_columns_.size(), nullptr);
+        size_t slot = 0;
+        for (size_t c = 0; c < csv_columns_.size(); ++c) {
+            if (IsProjected(c)) {
+                storage_[c] = arena_.GetColumn(slot++);
+            }
+            csv_columns_[c].SetStorage(storage_[c]);
+        }
+    }
+    void GrowColumns(const size_t capacity) {
+        // Larger arena for input of unknown length; columns keep their values.
+        arena_.Grow(capacity);
+        size_t slot = 0;
+        for (size_t c = 0; c < csv_columns_.size(); ++c) {
+            if (storage_[c]) {
+                storage_[c] = arena_.GetColumn(slot++);
+                csv_columns_[c].SetStorage(storage_[c], csv_columns_[c].GetSize());
+            }
+        }
     }
     void ReadLines() {
-        if (f_csv_.good()) {
-            // If file is good, read the lines.
-            std::string line;
-            bool header_once = true;
-            while (std::getline(f_csv_, line)) {
-                // Strip whitespaced (space, \t, \r) in the line.
-                auto strip_line = TextUtility::Strip(line);
-                if (strip_line.empty()) {
-                    // Skip empty lines.
-                    continue;
+        if (f_csv_.IsStream()) {
+            ReadLinesStream();
+            return;
+        }
+        size_t threads = threads_ > 0 ? threads_ : ThreadPool::DefaultThreads();
+        size_t parts = std::min(threads, f_csv_.RemainingBytes() / kMinChunkSize);
+        if (parts > 1) {
+            ReadLinesParallel(parts);
+            return;
+        }
+        if (f_csv_.IsOpen()) {
+            // Line count bounds the values per column.
+            AllocateColumns(f_csv_.RemainingLines());
+            // Other lines are data lines; add values to the corresponding columns.
+            while (f_csv_.ReadFields([this](size_t index, const char* b, const char* e){
+                if (index < csv_columns_.size()) {
+                    csv_columns_[index].AddValue(CsvTokenizer::ToDouble(b, e));
+                }
+            }, GetProjection())) {
+                ++number_of_lines_;
+            }
+        }
+    }
+    void ReadLinesStream() {
+        // Lines of compressed or piped input are counted as they come; columns grow
+        // to twice their capacity when full.
+        AllocateColumns(kStreamCapacity);
+        while (f_csv_.ReadFields([this](size_t index, const char* b, const char* e){
+            if (index < csv_columns_.size()) {
+                csv_columns_[index].AddValue(CsvTokenizer::ToDouble(b, e));
+            }
+        }, GetProjection())) {
+            if (++number_of_lines_ == arena_.GetCapacity()) {
+                GrowColumns(2 * arena_.GetCapacity());
+            }
+        }
+    }
+    void ReadLinesParallel(const size_t parts) {
+        // Tokenize and convert chunks of whole lines on separate threads. Each
+        // chunk writes into the columns from the line count of the chunks
+        // before it; segments are then closed up in row order.
+        auto ranges = f_csv_.SplitRemaining(parts);
+        const size_t columns = csv_columns_.size();
+        ThreadPool pool(std::min(parts, ranges.size()));
+        std::vector<size_t> offsets(ranges.size() + 1, 0);
+        pool.ParallelFor(ranges.size(), [&](size_t i){
+            offsets[i + 1] = CsvTokenizer::CountLines(ranges[i].first, ranges[i].second);
+        });
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            offsets[i + 1] += offsets[i];
+        }
+        AllocateColumns(offsets.back());
+        std::vector<std::vector<size_t>> counts(ranges.size(), std::vector<size_t>(columns, 0));
+        std::vector<size_t> lines(ranges.size(), 0);
+        pool.ParallelFor(ranges.size(), [&](size_t i){
+            CsvReader chunk(ranges[i]);
+            auto & count = counts[i];
+            const size_t offset = offsets[i];
+            while (chunk.ReadFields([&](size_t index, const char* b, const char* e){
+                if (index < columns) {
+                    storage_[index][offset + count[index]++] = CsvTokenizer::ToDouble(b, e);
                 }
-                if (header_once) {
-                    // First line is the header.
-                    header_once = false;
-                    // Create CsvColumn objects from the header line.
-                    IterateValues(strip_line, [this](const std::string& value){
-                        csv_columns_.push_back(std::make_shared<CsvColumn>(value));
-                    });
-                } else {
-                    size_t index = 0;
-                    // Other lines are data lines; add values to the corresponding columns.
-                    IterateValues(strip_line, [this, &index](const std::string& value){
-                        csv_columns_[index]->AddValue(std::stod(value));
-                        index++;
-                    });
+            }, GetProjection())) {
+                ++lines[i];
+            }
+        });
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            number_of_lines_ += lines[i];
+        }
+        for (size_t c = 0; c < columns; ++c) {
+            double* values = storage_[c];
+            if (! values) {
+                continue;
+            }
+            size_t size = 0;
+            for (size_t i = 0; i < ranges.size(); ++i) {
+                if (size != offsets[i]) {
+                    std::memmove(values + size, values + offsets[i], counts[i][c] * sizeof(double));
                 }
+                size += counts[i][c];
             }
-            number_of_lines_ = csv_columns_[0]->GetSize();
-            number_of_columns_ = csv_columns_.size();
+            csv_columns_[c].SetStorage(values, size);
+        }
+    }
+    bool LoadCache() {
+        CsvProfiler::Scope phase("cache load");
+        CsvCache::Source source = {};
+        if (! CsvCache::GetSource(filename_, source)) {
+            return false;
+        }
+        cache_ = std::make_unique<CsvCache>(filename_);
+        if (! cache_->Load(source) || cache_->GetColumnNames().size() != csv_columns_.size()) {
+            cache_.reset();
+            return false;
+        }
+        for (size_t c = 0; c < csv_columns_.size(); ++c) {
+            // Mapping is read-only; columns loaded from it are never added to.
+            csv_columns_[c].SetStorage(const_cast<double*>(cache_->GetValues(c)), cache_->GetSize(c));
+        }
+        number_of_lines_ = cache_->GetNumberOfLines();
+        return true;
+    }
+    void WriteCache() {
+        CsvCache::Source source = {};
+        CsvCache cache(filename_);
+        if (! CsvCache::GetSource(filename_, source) || ! cache.Write(source, csv_columns_, number_of_lines_)) {
+            std::cerr << "Unable to write cache " << cache.GetPath() << "\n";
         }
     }
     void Close() {
-        f_csv_.close();
+        read_error_ = read_error_ || f_csv_.Failed();
+        f_csv_.Close();
     }
     void DumpColumns() {
         // Dump all values for all columns.
         for (auto & col : csv_columns_) {
-            col->Dump();
-        }
-    }
-    void IterateValues(const std::string& line, std::function<void(const std::string& value)> fun) {
-        // Iterate over the comma separated values in a line.
-        std::string value;
-        for (auto c : line) {
-            if (c == ',') {
-                if (value != "") {
-                    fun(value);
-                    value.clear();
-                }
-            } else {
-                value += c;
-            }
-        }
-        // Omit trailing comma.
-        if (value != "") {
-            fun(value);
+            col.Dump();
         }
     }
 };
@@ -0,0 +1,163 @@
+#ifndef CSV_GENERATOR_HPP
+#define CSV_GENERATOR_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Writes a synthetic reference/data file pair. Reference columns are smooth
+// signals over a time column; data columns are the same values with uniform
+// noise, NaN values and renamed headers added. Output depends only on the
+// settings and the seed, so file pairs are reproducible on any platform.
+class CsvGenerator {
+private:
+    size_t rows_;
+    size_t columns_;
+    double nan_density_;
+    double noise_;
+    double drift_;
+    uint64_t seed_;
+    uint64_t state_;
+
+public:
+    CsvGenerator()
+    : rows_(100000)
+    , columns_(20)
+    , nan_density_(0.0)
+    , noise_(1e-6)
+    , drift_(0.0)
+    , seed_(1)
+    , state_(0)
+    {}
+    ~CsvGenerator() {}
+    void SetRows(const size_t rows) {
+        rows_ = rows;
+    }
+    void SetColumns(const size_t columns) {
+        // Signal columns, besides the time column.
+        columns_ = columns;
+    }
+    void SetNanDensity(const double& density) {
+        // Fraction of data values replaced by NaN.
+        nan_density_ = density;
+    }
+    void SetNoise(const double& noise) {
+        // Largest difference added to data values.
+        noise_ = noise;
+    }
+    void SetDrift(const double& drift) {
+        // Fraction of data column names which are changed slightly.
+        drift_ = drift;
+    }
+    void SetSeed(const uint64_t seed) {
+        seed_ = seed;
+    }
+    bool Write(const std::string& ref_filename, const std::string& data_filename) {
+        state_ = seed_;
+        std::vector<std::string> ref_names(1, "t");
+        for (size_t c = 0; c < columns_; ++c) {
+            ref_names.push_back("sig[" + std::to_string(c) + "]");
+        }
+        std::vector<std::string> data_names(ref_names);
+        for (size_t c = 1; c < data_names.size(); ++c) {
+            if (Uniform() < drift_) {
+                data_names[c] = Drift(data_names[c]);
+            }
+        }
+        // Frequency and amplitude per column.
+        std::vector<double> frequency(columns_), amplitude(columns_);
+        for (size_t c = 0; c < columns_; ++c) {
+            frequency[c] = 0.1 + 10.0 * Uniform();
+            amplitude[c] = std::pow(10.0, 6.0 * Uniform() - 2.0);
+        }
+
+        FILE* ref = std::fopen(ref_filename.c_str(), "wb");
+        FILE* data = std::fopen(data_filename.c_str(), "wb");
+        if (! ref || ! data) {
+            std::cerr << "Unable to write " << (ref ? data_filename : ref_filename) << "\n";
+            if (ref) {
+                std::fclose(ref);
+            }
+            if (data) {
+                std::fclose(data);
+            }
+            return false;
+        }
+        std::string ref_line, data_line;
+        WriteHeader(ref, ref_names);
+        WriteHeader(data, data_names);
+        char buf[64];
+        for (size_t r = 0; r < rows_; ++r) {
+            double t = r * 1e-3;
+            std::snprintf(buf, sizeof(buf), "%.6f", t);
+            ref_line = buf;
+            data_line = buf;
+            for (size_t c = 0; c < columns_; ++c) {
+                double value = amplitude[c] * std::sin(frequency[c] * t + c);
+                std::snprintf(buf, sizeof(buf), ", %.10g", value);
+                ref_line += buf;
+                if (Uniform() < nan_density_) {
+                    data_line += ", nan";
+                } else {
+                    std::snprintf(buf, sizeof(buf), ", %.10g", value + noise_ * (2.0 * Uniform() - 1.0));
+                    data_line += buf;
+                }
+            }
+            ref_line += '\n';
+            data_line += '\n';
+            std::fwrite(ref_line.data(), 1, ref_line.size(), ref);
+            std::fwrite(data_line.data(), 1, data_line.size(), data);
+        }
+        bool ok = ! std::ferror(ref) && ! std::ferror(data);
+        ok = std::fclose(ref) == 0 && ok;
+        ok = std::fclose(data) == 0 && ok;
+        if (! ok) {
+            std::cerr << "Unable to write " << ref_filename << " / " << data_filename << "\n";
+        }
+        return ok;
+    }
+
+private:
+    uint64_t Next() {
+        // splitmix64; same sequence on every platform, unlike std distributions.
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    double Uniform() {
+        // Uniform in [0, 1), from the top 53 bits.
+        return (Next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+    std::string Drift(const std::string& name) {
+        // Small edit of a name, as left by renaming in a solver: case change,
+        // inserted character, or a suffix.
+        std::string result(name);
+        switch (Next() % 3) {
+        case 0:
+            result[0] = static_cast<char>(result[0] - 'a' + 'A');
+            break;
+        case 1:
+            result.insert(result.find('['), "_");
+            break;
+        default:
+            result += "_v2";
+            break;
+        }
+        return result;
+    }
+    void WriteHeader(FILE* file, const std::vector<std::string>& names) {
+        std::string line;
+        for (size_t c = 0; c < names.size(); ++c) {
+            line += (c > 0 ? ", " : "") + names[c];
+        }
+        line += '\n';
+        std::fwrite(line.data(), 1, line.size(), file);
+    }
+};
+
+#endif // CSV_GENERATOR_HPP
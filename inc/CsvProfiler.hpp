@@ -0,0 +1,201 @@
+#ifndef CSV_PROFILER_HPP
+#define CSV_PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+// Wall time, throughput, allocations and peak memory of the phases of a run.
+// Phases are marked with Scope objects and nest; nothing is recorded unless
+// profiling is enabled. Allocations are counted by the operator new of the
+// executable (CSVDIFF_COUNT_ALLOCATIONS), for all threads, so phases running
+// in parallel share counts; only while profiling is enabled.
+class CsvProfiler {
+private:
+    struct Record {
+        std::string name;
+        int depth;
+        std::chrono::steady_clock::time_point start;
+        double seconds;
+        size_t bytes;
+        size_t rows;
+        size_t allocations;
+        long peak_rss_kb;
+    };
+    bool enabled_;
+    std::mutex mutex_;
+    std::vector<Record> records_;
+
+    CsvProfiler()
+    : enabled_(false)
+    {}
+
+public:
+    class Scope {
+    private:
+        size_t index_;
+
+    public:
+        Scope(const std::string& name)
+        : index_(Instance().Begin(name))
+        {}
+        ~Scope() {
+            Instance().End(index_);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        void SetBytes(const size_t bytes) {
+            Instance().Set(index_, bytes, 0);
+        }
+        void SetRows(const size_t rows) {
+            Instance().Set(index_, 0, rows);
+        }
+    };
+
+    static CsvProfiler& Instance() {
+        static CsvProfiler profiler;
+        return profiler;
+    }
+    static std::atomic<size_t>& Allocations() {
+        // Constant initialized, so usable from operator new at any time.
+        static std::atomic<size_t> allocations(0);
+        return allocations;
+    }
+    static std::atomic<bool>& Counting() {
+        static std::atomic<bool> counting(false);
+        return counting;
+    }
+    static void CountAllocation() {
+        if (Counting().load(std::memory_order_relaxed)) {
+            Allocations().fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void Enable() {
+        enabled_ = true;
+        Counting().store(true, std::memory_order_relaxed);
+    }
+    bool IsEnabled() const {
+        return enabled_;
+    }
+    void Show() {
+        // Phase table, nested phases indented below their parent.
+        std::lock_guard<std::mutex> lock(mutex_);
+        char buf[1024];
+        std::cout << "\n== Profile ==\n";
+        snprintf(buf, sizeof(buf), "%-32s : %12s %12s %14s %12s %14s"
+            , "Phase", "Time (ms)", "MB/s", "Rows/s", "Allocations", "Peak RSS (MB)");
+        std::cout << buf << "\n";
+        for (auto & record : records_) {
+            std::string name = std::string(2 * record.depth, ' ') + record.name;
+            snprintf(buf, sizeof(buf), "%-32s : %12.3f %12s %14s %12zu %14.1f"
+                , name.c_str()
+                , record.seconds * 1e3
+                , Rate(record.bytes / 1e6, record.seconds, "%.1f").c_str()
+                , Rate(static_cast<double>(record.rows), record.seconds, "%.0f").c_str()
+                , record.allocations
+                , record.peak_rss_kb / 1024.0
+            );
+            std::cout << buf << "\n";
+        }
+    }
+    bool WriteJson(const std::string& filename) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ofstream out(filename);
+        if (! out.good()) {
+            std::cerr << "Unable to write " << filename << "\n";
+            return false;
+        }
+        char buf[512];
+        out << "{\n  \"phases\": [";
+        for (size_t i = 0; i < records_.size(); ++i) {
+            const Record& record = records_[i];
+            snprintf(buf, sizeof(buf)
+                , "\"depth\": %d, \"seconds\": %.9f, \"bytes\": %zu, \"rows\": %zu, \"allocations\": %zu, \"peak_rss_kb\": %ld"
+                , record.depth, record.seconds, record.bytes, record.rows, record.allocations, record.peak_rss_kb);
+            out << (i > 0 ? "," : "") << "\n    {\"name\": \"" << Escape(record.name) << "\", " << buf << "}";
+        }
+        snprintf(buf, sizeof(buf), "\"allocations\": %zu, \"peak_rss_kb\": %ld", Allocations().load(), PeakRssKb());
+        out << "\n  ],\n  " << buf << "\n}\n";
+        return out.good();
+    }
+
+private:
+    size_t Begin(const std::string& name) {
+        if (! enabled_) {
+            return static_cast<size_t>(-1);
+        }
+        Record record;
+        record.name = name;
+        record.depth = Depth()++;
+        record.bytes = 0;
+        record.rows = 0;
+        record.seconds = 0.0;
+        record.peak_rss_kb = 0;
+        record.allocations = Allocations().load(std::memory_order_relaxed);
+        record.start = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_.push_back(record);
+        return records_.size() - 1;
+    }
+    void End(const size_t index) {
+        if (index == static_cast<size_t>(-1)) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        size_t allocations = Allocations().load(std::memory_order_relaxed);
+        long peak = PeakRssKb();
+        --Depth();
+        std::lock_guard<std::mutex> lock(mutex_);
+        Record& record = records_[index];
+        record.seconds = std::chrono::duration<double>(now - record.start).count();
+        record.allocations = allocations - record.allocations;
+        record.peak_rss_kb = peak;
+    }
+    void Set(const size_t index, const size_t bytes, const size_t rows) {
+        if (index == static_cast<size_t>(-1)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_[index].bytes += bytes;
+        records_[index].rows += rows;
+    }
+    static int& Depth() {
+        // Nesting level of the calling thread.
+        static thread_local int depth = 0;
+        return depth;
+    }
+    static long PeakRssKb() {
+        // Peak resident set size of the process so far; kilobytes on Linux.
+        struct rusage usage;
+        if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+        return usage.ru_maxrss;
+    }
+    static std::string Rate(const double& amount, const double& seconds, const char* format) {
+        char buf[64];
+        if (amount <= 0.0 || seconds <= 0.0) {
+            return "-";
+        }
+        snprintf(buf, sizeof(buf), format, amount / seconds);
+        return buf;
+    }
+    static std::string Escape(const std::string& text) {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+};
+
+#endif // CSV_PROFILER_HPP
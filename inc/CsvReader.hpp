@@ -0,0 +1,211 @@
+#ifndef CSV_READER_HPP
+#define CSV_READER_HPP
+
+#include "CsvTokenizer.hpp"
+#include "DecompressStream.hpp"
+#include "MappedFile.hpp"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef std::pair<const char*, const char*> CsvRange;
+
+// Reads lines of a file mapped into memory, or of a compressed file or pipe
+// as its data arrives. Such data comes in blocks; a line cut by the end of
+// a block is carried over and completed from the next one.
+//
+// A followed file is one still being written: it is read from where the
+// last read stopped, and a last line without '\n' is left for a later read.
+class CsvReader {
+private:
+    // Largest read of data appended to a followed file.
+    static const size_t kFollowBlockSize = 1 << 20;
+
+    std::string filename_;
+    MappedFile file_;
+    std::unique_ptr<DecompressStream> stream_;
+    std::vector<char> buffer_;
+    std::vector<char> block_;
+    const char* pos_;
+    const char* end_;
+    bool open_;
+    bool follow_;
+    // A stream ended on an error; kept after Close().
+    bool failed_;
+    int fd_;
+
+public:
+    CsvReader(const std::string& filename)
+    : filename_(filename)
+    , file_(filename)
+    , pos_(nullptr)
+    , end_(nullptr)
+    , open_(false)
+    , follow_(false)
+    , failed_(false)
+    , fd_(-1)
+    {}
+    CsvReader(const CsvRange& range)
+    : file_("")
+    , pos_(range.first)
+    , end_(range.second)
+    , open_(true)
+    , follow_(false)
+    , failed_(false)
+    , fd_(-1)
+    {}
+    ~CsvReader() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+    void SetFollow(const bool follow) {
+        follow_ = follow;
+    }
+    bool Open() {
+        if (follow_) {
+            fd_ = ::open(filename_.c_str(), O_RDONLY);
+            if (fd_ < 0) {
+                return false;
+            }
+            pos_ = end_ = nullptr;
+            open_ = true;
+            return true;
+        }
+        if (DecompressStream::IsStream(filename_)) {
+            stream_ = std::make_unique<DecompressStream>(filename_);
+            if (! stream_->Start()) {
+                stream_.reset();
+                return false;
+            }
+            pos_ = end_ = nullptr;
+            open_ = true;
+            return true;
+        }
+        if (! file_.Open()) {
+            return false;
+        }
+        pos_ = file_.Begin();
+        end_ = file_.End();
+        open_ = true;
+        return true;
+    }
+    void Close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        file_.Close();
+        stream_.reset();
+        buffer_.clear();
+        pos_ = end_ = nullptr;
+        open_ = false;
+    }
+    bool IsOpen() const {
+        return open_;
+    }
+    bool Failed() const {
+        // True if the input could not be read to its end.
+        return failed_;
+    }
+    bool IsStream() const {
+        // Data comes in blocks; size and line count are not known in advance.
+        return stream_ != nullptr;
+    }
+    size_t RemainingBytes() const {
+        return end_ - pos_;
+    }
+    std::vector<CsvRange> SplitRemaining(const size_t parts) {
+        // Split unread lines into parts of about equal size, at line boundaries.
+        // The reader itself is left at the end.
+        std::vector<CsvRange> ranges;
+        size_t step = RemainingBytes() / (parts > 0 ? parts : 1);
+        const char* begin = pos_;
+        for (size_t i = 1; i < parts && begin < end_; ++i) {
+            const char* cut = pos_ + i * step;
+            if (cut <= begin) {
+                continue;
+            }
+            cut = CsvTokenizer::NextLine(CsvTokenizer::FindLineEnd(cut, end_), end_);
+            ranges.push_back(CsvRange(begin, cut));
+            begin = cut;
+        }
+        if (begin < end_) {
+            ranges.push_back(CsvRange(begin, end_));
+        }
+        pos_ = end_;
+        return ranges;
+    }
+    size_t RemainingLines() const {
+        // Upper bound for the number of lines not read yet.
+        return CsvTokenizer::CountLines(pos_, end_);
+    }
+    template <typename Fun>
+    bool ReadFields(Fun&& fun, const FieldMask* mask=nullptr) {
+        // Read the next non-empty line, calling fun(index, begin, end) per
+        // field; only for fields in mask, if given.
+        for (;;) {
+            if (pos_ == end_ && ! Refill()) {
+                return false;
+            }
+            const char* line = pos_;
+            const char* line_end = CsvTokenizer::FindLineEnd(pos_, end_);
+            if (line_end == end_ && Refill()) {
+                // Line continues in the next block.
+                continue;
+            }
+            if (line_end == end_ && follow_) {
+                // Line is still being written.
+                return false;
+            }
+            pos_ = CsvTokenizer::NextLine(line_end, end_);
+            if (CsvTokenizer::IsBlank(line, line_end)) {
+                // Skip empty lines.
+                continue;
+            }
+            CsvTokenizer::ForEachField(line, line_end, mask, fun);
+            return true;
+        }
+    }
+
+private:
+    bool Refill() {
+        // Append the next block of a stream, or data appended to a followed
+        // file, to the unread rest of the buffer.
+        if (follow_) {
+            if (! ReadAppended()) {
+                return false;
+            }
+        } else if (! stream_ || ! stream_->Read(block_)) {
+            failed_ = failed_ || (stream_ && stream_->Failed());
+            return false;
+        }
+        size_t rest = end_ - pos_;
+        if (rest > 0) {
+            std::memmove(buffer_.data(), pos_, rest);
+        }
+        buffer_.resize(rest);
+        buffer_.insert(buffer_.end(), block_.begin(), block_.end());
+        pos_ = buffer_.data();
+        end_ = pos_ + buffer_.size();
+        return true;
+    }
+    bool ReadAppended() {
+        // Bytes written to the followed file since the last read, if any.
+        block_.resize(kFollowBlockSize);
+        ssize_t size = ::read(fd_, block_.data(), block_.size());
+        if (size <= 0) {
+            block_.clear();
+            return false;
+        }
+        block_.resize(static_cast<size_t>(size));
+        return true;
+    }
+};
+
+#endif // CSV_READER_HPP
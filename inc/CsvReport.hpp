@@ -1,6 +1,12 @@
 #ifndef CSV_REPORT_HPP
 #define CSV_REPORT_HPP
 
+#include "CsvResult.hpp"
+#include "BinaryReportWriter.hpp"
+#include "CsvReportWriter.hpp"
+#include "JsonReportWriter.hpp"
+#include "TextReportWriter.hpp"
+
 #include <vector>
 #include <string>
 #include <limits>
@@ -8,6 +14,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <utility>
 
 class CsvReport {
 private:
@@ -15,20 +22,35 @@ private:
     bool hide_nan_;
     bool group_by_result_;
     bool brief_;
+    std::string format_;
     size_t same_count_;
     size_t nan_count_;
+    size_t compared_count_;
     size_t column_count_;
     size_t ref_line_count_;
     size_t data_line_count_;
+    // Row alignment on a key column, if used.
+    std::string key_;
+    std::string join_method_;
+    size_t matched_count_;
+    size_t ref_unmatched_count_;
+    size_t data_unmatched_count_;
+    // Gate mode: pass/fail message, with the first value out of tolerance.
+    bool gate_;
+    std::string gate_message_;
     double eps_ = std::numeric_limits<double>::quiet_NaN();
-    std::vector<std::string> lines_;
-    std::vector<std::string> var_lines_;
-    std::vector<std::string> matching_suggestions_;
+    std::vector<CsvResult> results_;
+    std::vector<std::pair<std::string, std::string>> matching_suggestions_;
 
     double max_diff_, min_diff_;
     double mean_, sd_, var_;
     double mean_abs_, sd_abs_, var_abs_;
     std::string column_name_;
+    std::vector<TopRows::Row> top_rows_;
+    size_t top_row_count_;
+    // Percentiles (0..100) of absolute differences shown, with values of the current column.
+    std::vector<double> percentiles_;
+    std::vector<double> percentile_values_;
 
 public:
     CsvReport() {
@@ -36,8 +58,18 @@ public:
         hide_nan_ = false;
         group_by_result_ = false;
         brief_ = false;
+        format_ = "text";
         same_count_ = 0;
         nan_count_ = 0;
+        compared_count_ = 0;
+        column_count_ = 0;
+        ref_line_count_ = 0;
+        data_line_count_ = 0;
+        matched_count_ = 0;
+        ref_unmatched_count_ = 0;
+        data_unmatched_count_ = 0;
+        top_row_count_ = 0;
+        gate_ = false;
     }
     ~CsvReport() {}
     void SetEpsilon(const double& eps) {
@@ -48,6 +80,12 @@ public:
         hide_same_ = true;
         hide_nan_ = true;
     }
+    static bool IsFormat(const std::string& format) {
+        return format == "text" || format == "csv" || format == "jsonl" || format == "binary";
+    }
+    void SetFormat(const std::string& format) {
+        format_ = format;
+    }
     void SetHideSame(const bool hide) {
         hide_same_ = hide;
     }
@@ -64,10 +102,38 @@ public:
         ref_line_count_ = c_ref;
         data_line_count_ = c_data;
     }
+    void SetAlignment(const std::string& key, const std::string& method, const size_t matched, const size_t ref_unmatched, const size_t data_unmatched) {
+        key_ = key;
+        join_method_ = method;
+        matched_count_ = matched;
+        ref_unmatched_count_ = ref_unmatched;
+        data_unmatched_count_ = data_unmatched;
+    }
+    void SetGatePassed(const size_t rows, const size_t columns) {
+        char buf[256];
+        gate_ = true;
+        snprintf(buf, sizeof(buf), "== Gate passed; %zu rows of %zu columns within eps = %g ==", rows, columns, eps_);
+        gate_message_ = buf;
+    }
+    void SetGateViolation(const std::string& column, const size_t row, const double& ref, const double& data) {
+        char buf[1024];
+        gate_ = true;
+        snprintf(buf, sizeof(buf), "== Gate failed; column %s, row %zu: Ref(%.15g) Data(%.15g), |diff| = %g @ eps = %g =="
+            , column.c_str(), row, ref, data, std::fabs(ref - data), eps_);
+        gate_message_ = buf;
+    }
+    void SetGateError(const std::string& reason) {
+        gate_ = true;
+        gate_message_ = "== Gate error; " + reason + " ==";
+    }
+    void SetGateRowViolation(const size_t row, const bool in_ref) {
+        char buf[256];
+        gate_ = true;
+        snprintf(buf, sizeof(buf), "== Gate failed; row %zu: only in %s file ==", row, in_ref ? "Ref" : "Data");
+        gate_message_ = buf;
+    }
     void Init() {
-        lines_.clear();
-        lines_.push_back(GetEpsLine());
-        lines_.push_back(GetTableHeader());
+        results_.clear();
     }
     void SetColumnName(const std::string& name) {
         column_name_ = name;
@@ -86,89 +152,115 @@ public:
         sd_abs_ = sd;
         var_abs_ = var;
     }
+    void SetTopRowCount(const size_t count) {
+        top_row_count_ = count;
+    }
+    void SetPercentiles(const std::vector<double>& percentiles) {
+        percentiles_ = percentiles;
+    }
+    void SetPercentileValues(std::vector<double> values) {
+        percentile_values_ = std::move(values);
+    }
+    void SetTopRows(std::vector<TopRows::Row> rows) {
+        top_rows_ = std::move(rows);
+    }
     void ColumnMatchingSuggestion(const std::string& refName, const std::string& dataName) {
-        char buf[1024];
-        snprintf(buf, sizeof(buf)
-            , "%-30s --> %-30s"
-            , refName.c_str()
-            , dataName.c_str()
-        );
-        matching_suggestions_.push_back(std::string(buf));
+        matching_suggestions_.push_back(std::make_pair(refName, dataName));
     }
     void WriteVariableStats() {
-        char buf[1024];
+        CsvResult result;
+        ++compared_count_;
         if (std::fabs(mean_) <= std::numeric_limits<double>::epsilon() &&
             sd_ <= std::numeric_limits<double>::epsilon() &&
             mean_abs_ <= std::numeric_limits<double>::epsilon() &&
             sd_abs_ <= std::numeric_limits<double>::epsilon()
         ) {
-            ++same_count_;
-            if (hide_same_) {
-                return;
-            }
             // If values are all zero, report as "same".
-            snprintf(buf, sizeof(buf)
-                , "99:%-32s : Values are same"
-                , column_name_.c_str()
-            );
+            ++same_count_;
+            result.status = CsvResult::kSame;
         }
         else if (std::isnan(mean_)) {
             // If values contain NaN, report as "NaN".
             ++nan_count_;
-            if (hide_nan_) {
-                return;
-            }
-            snprintf(buf, sizeof(buf)
-                , "98:%-32s : NaN values in column!"
-                , column_name_.c_str()
-            );
+            result.status = CsvResult::kNan;
         } else {
             // Otherwise, report the statistics.
-            snprintf(buf, sizeof(buf)
-                , "00:%-32s : %20g %20g %20g %20g %20g %20g"
-                , column_name_.c_str()
-                , max_diff_
-                , min_diff_
-                , mean_
-                , sd_
-                , mean_abs_
-                , sd_abs_
-            );
+            result.status = CsvResult::kDiffers;
         }
-        var_lines_.push_back(std::string(buf));
+        result.name = column_name_;
+        result.max = max_diff_;
+        result.min = min_diff_;
+        result.mean = mean_;
+        result.sd = sd_;
+        result.mean_abs = mean_abs_;
+        result.sd_abs = sd_abs_;
+        result.top = std::move(top_rows_);
+        top_rows_.clear();
+        result.percentiles = std::move(percentile_values_);
+        percentile_values_.clear();
+        results_.push_back(std::move(result));
+    }
+    size_t GetComparedCount() const {
+        return compared_count_;
+    }
+    size_t GetSameCount() const {
+        return same_count_;
+    }
+    size_t GetNanCount() const {
+        return nan_count_;
+    }
+    bool HasRowMismatch() const {
+        // Rows missing on either side; by line count unless aligned on a key.
+        if (! key_.empty()) {
+            return ref_unmatched_count_ > 0 || data_unmatched_count_ > 0;
+        }
+        return ref_line_count_ != data_line_count_;
+    }
+    size_t GetRefLineCount() const {
+        return ref_line_count_;
+    }
+    size_t GetDataLineCount() const {
+        return data_line_count_;
     }
     void Show() {
-        if (brief_) {
+        if (gate_) {
+            std::cout << "\n" << gate_message_ << "\n";
+        } else if (format_ != "text") {
+            WriteResults(*MakeWriter(std::cout));
+        } else if (brief_) {
             std::cout << "\n";
             std::cout << "NaN : " << nan_count_ << "/" << column_count_ << " ";
             std::cout << "Same : " << same_count_ << "/" << column_count_ << " ";
+            if (! key_.empty()) {
+                std::cout << "Unmatched : " << ref_unmatched_count_ << "/" << data_unmatched_count_ << " ";
+            }
             std::cout << "@ eps = " << eps_ << "\n";
         } else {
             
-            if (ref_line_count_ != data_line_count_) {
+            if (! key_.empty()) {
+                std::cout << "\n== Rows aligned on " << key_ << " (" << join_method_ << " join); matched " << matched_count_;
+                std::cout << ", unmatched Ref(" << ref_unmatched_count_ << ") Data(" << data_unmatched_count_ << ") ==\n";
+            } else if (ref_line_count_ != data_line_count_) {
                 std::cerr << "\n== Line count mismatch; Ref(" << ref_line_count_ << ") != Data(" << data_line_count_ << "). ";
                 std::cerr << "Smaller one will be used for comparison. ==\n";
             }
             
             if (! matching_suggestions_.empty()) {
+                char buf[1024];
                 std::cout << "\n== Non-matching reference columns /w suggested (--match) data columns ==\n";
-                for (const auto& line : matching_suggestions_) {
-                    std::cout << line << "\n";
+                for (const auto& suggestion : matching_suggestions_) {
+                    snprintf(buf, sizeof(buf)
+                        , "%-30s --> %-30s"
+                        , suggestion.first.c_str()
+                        , suggestion.second.c_str()
+                    );
+                    std::cout << buf << "\n";
                 }
                 std::cout << "\n";
             }
 
-            if (group_by_result_) {
-                std::sort(var_lines_.begin(), var_lines_.end());
-            }
-            for (const auto& line : var_lines_) {
-                lines_.push_back(line.substr(3));
-            }
-
-            for (const auto& line : lines_) {
-                std::cout << line << "\n";
-            }
-            std::cout << "\n";
+            TextReportWriter writer(std::cout);
+            WriteResults(writer);
 
             if (hide_nan_ && nan_count_ > 0) {
                 std::cout << "Number of NaN columns: " << nan_count_ << "\n";
@@ -181,25 +273,54 @@ public:
     }
 
 private:
-    const std::string GetEpsLine() {
-        char buf[256];
-        sprintf(buf, "Epsilon = %g\n", eps_);
-        return std::string(buf);
+    ReportWriterPtr MakeWriter(std::ostream& out) const {
+        if (format_ == "csv") {
+            return std::make_unique<CsvReportWriter>(out);
+        } else if (format_ == "jsonl") {
+            return std::make_unique<JsonReportWriter>(out);
+        } else if (format_ == "binary") {
+            return std::make_unique<BinaryReportWriter>(out);
+        }
+        return std::make_unique<TextReportWriter>(out);
     }
-    const std::string GetTableHeader() {
-        // Return header line for the report.
-        char buf[1024];
-        snprintf(buf, sizeof(buf)
-            , "%-32s : %20s %20s %20s %20s %20s %20s"
-            , "Variable (ref)"
-            , "Max"
-            , "Min"
-            , "Mean"
-            , "SD"
-            , "Mean (abs)"
-            , "SD (abs)"
-        );
-        return std::string(buf);
+    bool IsHidden(const CsvResult& result) const {
+        return (hide_same_ && result.status == CsvResult::kSame) || (hide_nan_ && result.status == CsvResult::kNan);
+    }
+    void WriteResults(ReportWriter& writer) {
+        // Pass shown columns to the writer, grouped by result if requested.
+        if (group_by_result_) {
+            std::stable_sort(results_.begin(), results_.end(), [](const CsvResult& a, const CsvResult& b) {
+                if (a.status != b.status) {
+                    return a.status < b.status;
+                }
+                return CsvResult::NameBefore(a.name, b.name);
+            });
+        }
+        CsvResultTotals totals;
+        totals.eps = eps_;
+        totals.columns = column_count_;
+        totals.compared = compared_count_;
+        totals.same = same_count_;
+        totals.nan = nan_count_;
+        totals.ref_lines = ref_line_count_;
+        totals.data_lines = data_line_count_;
+        totals.percentiles = percentiles_;
+        totals.top_rows = top_row_count_;
+        totals.key = key_;
+        totals.join_method = join_method_;
+        totals.matched = matched_count_;
+        totals.ref_unmatched = ref_unmatched_count_;
+        totals.data_unmatched = data_unmatched_count_;
+        writer.Begin(totals);
+        for (const auto& suggestion : matching_suggestions_) {
+            writer.WriteSuggestion(suggestion.first, suggestion.second);
+        }
+        for (const auto& result : results_) {
+            if (! IsHidden(result)) {
+                writer.Write(result);
+            }
+        }
+        writer.End(totals);
     }
 };
 
@@ -0,0 +1,93 @@
+#ifndef CSV_REPORT_WRITER_HPP
+#define CSV_REPORT_WRITER_HPP
+
+#include "ReportWriter.hpp"
+
+#include <cstdio>
+
+// One CSV row per column; values in full precision, NaN as "nan". Requested
+// percentiles follow the statistics, as "p<percent>" columns, then the rows
+// with largest differences as "top<n>_..." columns, empty past the last one.
+// With rows paired on a key column, each row ends with the key and the match
+// counts.
+class CsvReportWriter : public ReportWriter {
+private:
+    CsvResultTotals totals_;
+
+public:
+    CsvReportWriter(std::ostream& out)
+    : ReportWriter(out)
+    {}
+    ~CsvReportWriter() {}
+    void Begin(const CsvResultTotals& totals) override {
+        char buf[128];
+        totals_ = totals;
+        out_ << "column,status,max,min,mean,sd,mean_abs,sd_abs";
+        for (auto p : totals.percentiles) {
+            snprintf(buf, sizeof(buf), ",p%g", p);
+            out_ << buf;
+        }
+        for (size_t i = 1; i <= totals.top_rows; ++i) {
+            snprintf(buf, sizeof(buf), ",top%zu_row,top%zu_data_row,top%zu_ref,top%zu_data,top%zu_diff_abs", i, i, i, i, i);
+            out_ << buf;
+        }
+        if (! totals.key.empty()) {
+            out_ << ",key,join,matched,ref_unmatched,data_unmatched";
+        }
+        out_ << "\n";
+    }
+    void Write(const CsvResult& result) override {
+        char buf[256];
+        WriteName(result.name);
+        snprintf(buf, sizeof(buf), ",%s,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g"
+            , CsvResult::GetStatusName(result.status)
+            , result.max
+            , result.min
+            , result.mean
+            , result.sd
+            , result.mean_abs
+            , result.sd_abs
+        );
+        out_ << buf;
+        for (auto value : result.percentiles) {
+            snprintf(buf, sizeof(buf), ",%.17g", value);
+            out_ << buf;
+        }
+        for (size_t i = 0; i < totals_.top_rows; ++i) {
+            if (i < result.top.size()) {
+                const TopRows::Row& row = result.top[i];
+                snprintf(buf, sizeof(buf), ",%zu,%zu,%.17g,%.17g,%.17g"
+                    , row.row + 1, row.data_row + 1, row.ref, row.data, row.diff_abs);
+                out_ << buf;
+            } else {
+                out_ << ",,,,,";
+            }
+        }
+        if (! totals_.key.empty()) {
+            out_ << ",";
+            WriteName(totals_.key);
+            out_ << "," << totals_.join_method << "," << totals_.matched;
+            out_ << "," << totals_.ref_unmatched << "," << totals_.data_unmatched;
+        }
+        out_ << "\n";
+    }
+
+private:
+    void WriteName(const std::string& name) {
+        // Quote names containing separators or quotes.
+        if (name.find_first_of(",\"\r\n") == std::string::npos) {
+            out_ << name;
+            return;
+        }
+        out_ << '"';
+        for (auto c : name) {
+            if (c == '"') {
+                out_ << '"';
+            }
+            out_ << c;
+        }
+        out_ << '"';
+    }
+};
+
+#endif // CSV_REPORT_WRITER_HPP
@@ -0,0 +1,78 @@
+#ifndef CSV_RESULT_HPP
+#define CSV_RESULT_HPP
+
+#include "TopRows.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Result of one compared column, as written by the report writers.
+struct CsvResult {
+    // In the order columns are grouped with --group.
+    enum Status {
+        kDiffers,
+        kNan,
+        kSame
+    };
+    std::string name;
+    Status status;
+    double max;
+    double min;
+    double mean;
+    double sd;
+    double mean_abs;
+    double sd_abs;
+    // Rows with largest differences, if tracked.
+    std::vector<TopRows::Row> top;
+    // Absolute differences at the requested percentiles.
+    std::vector<double> percentiles;
+
+    static const char* GetStatusName(const Status status) {
+        switch (status) {
+        case kDiffers: return "differs";
+        case kNan: return "nan";
+        default: return "same";
+        }
+    }
+    static bool NameBefore(const std::string& a, const std::string& b) {
+        // Names as shown in the text table, padded to 32 characters and
+        // followed by " : ", so grouping keeps the table's sort order.
+        const size_t kWidth = 32;
+        const size_t la = std::max(a.size(), kWidth);
+        const size_t lb = std::max(b.size(), kWidth);
+        static const char kSeparator[] = " : ";
+        for (size_t i = 0; i < std::min(la, lb) + 3; ++i) {
+            unsigned char ca = i < a.size() ? a[i] : i < la ? ' ' : kSeparator[i - la];
+            unsigned char cb = i < b.size() ? b[i] : i < lb ? ' ' : kSeparator[i - lb];
+            if (ca != cb) {
+                return ca < cb;
+            }
+        }
+        return false;
+    }
+};
+
+// Column and line counts of a report.
+struct CsvResultTotals {
+    double eps;
+    size_t columns;
+    size_t compared;
+    size_t same;
+    size_t nan;
+    size_t ref_lines;
+    size_t data_lines;
+    // Requested percentiles (0..100) of absolute differences.
+    std::vector<double> percentiles;
+    // Rows with largest differences tracked per column, zero if not.
+    size_t top_rows;
+    // Row alignment on a key column; key is empty if rows are paired by index.
+    std::string key;
+    std::string join_method;
+    size_t matched;
+    size_t ref_unmatched;
+    size_t data_unmatched;
+};
+
+#endif // CSV_RESULT_HPP
@@ -2,12 +2,14 @@
 #define CSV_STATS_HPP
 
 #include "CsvColumn.hpp"
+#include "DiffAccumulator.hpp"
 
 #include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
 class CsvStats {
 private:
@@ -15,6 +17,18 @@ private:
     std::string name_;
     CsvColumnPtr ref_;
     CsvColumnPtr data_;
+    DiffAccumulator acc_;
+    std::vector<DiffAccumulator> partials_;
+    size_t size_ = 0;
+    // Streaming input, collected into kernel blocks and chunks.
+    std::vector<double> ref_block_;
+    std::vector<double> data_block_;
+    DiffAccumulator chunk_;
+    size_t chunk_size_ = 0;
+    // Rows with largest differences kept per column, none if zero.
+    size_t top_rows_ = 0;
+    // Quantiles of absolute differences, if requested.
+    bool quantiles_ = false;
 
     double min_diff_abs_;
     double max_diff_abs_;
@@ -28,8 +42,13 @@ private:
     bool ready_ = false;
 
 public:
+    // Rows per partial result. Fixed, so results do not depend on thread count.
+    static const size_t kChunkSize = 1 << 16;
+
     CsvStats(const double& eps)
     : kEps(eps)
+    , acc_(eps)
+    , chunk_(eps)
     {}
     ~CsvStats() {}
     const bool Ready() const {
@@ -44,6 +63,16 @@ public:
     void SetDataColumn(CsvColumnPtr data) {
         data_ = data;
     }
+    void SetQuantiles(const bool quantiles) {
+        quantiles_ = quantiles;
+        acc_.SetQuantiles(quantiles);
+        chunk_.SetQuantiles(quantiles);
+    }
+    void SetTopRows(const size_t count) {
+        top_rows_ = count;
+        acc_.SetTopRows(count);
+        chunk_.SetTopRows(count);
+    }
     void GetMinMax(double& min, double& max) const {
         min = min_diff_abs_;
         max = max_diff_abs_;
@@ -61,73 +90,108 @@ public:
     const std::string& GetName() const {
         return name_;
     }
+    double GetQuantile(const double q) const {
+        // Absolute difference at quantile q (0..1), from the sketch.
+        return acc_.GetSketch().GetQuantile(q);
+    }
+    std::vector<TopRows::Row> GetTopRows() const {
+        return acc_.GetTopRows().GetRows();
+    }
     void Calculate() {
         if (ref_ && data_) {
             // Calculate statistics for a single column.
-            size_t ref_size = ref_->GetSize();
-            size_t data_size = data_->GetSize();
-            size_t size;
-            // Calculate data size to use. Use the smaller one if they differ.
-            if (ref_size != data_size) {
-                size = std::min(ref_size, data_size);
-            } else {
-                size = ref_size;
-            }
-            // Reset statistics variables for calculations.
-            double sum = 0.0, sum_abs = 0.0;
-            double sum_sq = 0.0, sum_abs_sq = 0.0;
-            min_diff_abs_ = 1e30;
-            max_diff_abs_ = -1e30;
-            for (size_t i = 0; i < size; ++i) {
-                auto ref_value = ref_->GetValue(i);
-                auto data_value = data_->GetValue(i);
-                // Calculate difference between reference and data values.
-                double diff;
-                if (std::isnan(ref_value) && std::isnan(data_value)) {
-                    diff = 0.0;
-                } else {
-                    diff = ref_value - data_value;
-                }
-                // Calculate absolute difference.
-                double diff_abs = std::fabs(diff);
-                // If difference is smaller than epsilon, assume it is zero.
-                if (diff_abs < kEps) {
-                    diff_abs = 0.0;
-                    diff = 0.0;
-                }
-                // Find mix/max for difference (absolute) values.
-                if (diff_abs < min_diff_abs_) {
-                    min_diff_abs_ = diff_abs;
-                }
-                if (diff_abs > max_diff_abs_) {
-                    max_diff_abs_ = diff_abs;
-                }
-                // Sums for mean values.
-                sum += diff;
-                sum_abs += diff_abs;
-                // Square sums for standard deviation values.
-                sum_sq += diff * diff;
-                sum_abs_sq += diff_abs * diff_abs;
+            Prepare();
+            for (size_t chunk = 0; chunk < GetNumberOfChunks(); ++chunk) {
+                CalculateChunk(chunk);
             }
-            // Calculate mean.
-            mean_diff_ = sum / size;
-            // Calculate variance.
-            var_diff_ = sum_sq / size - mean_diff_ * mean_diff_;
-            // Calculate mean (absolute).
-            mean_diff_abs_ = sum_abs / size;
-            // Calculate variance (absolute).
-            var_diff_abs_ = sum_abs_sq / size - mean_diff_abs_ * mean_diff_abs_;
-            // Calculate standard deviation.
-            sd_diff_ = std::sqrt(var_diff_);
-            // Calculate standard deviation (absolute).
-            sd_diff_abs_ = std::sqrt(var_diff_abs_);
-
-            ready_ = true;
+            Combine();
         } else {
             std::cerr << "CsvStats: reference or data column not set\n";
             ready_ = false;
         }
     }
+    void Prepare() {
+        // Calculate data size to use. Use the smaller one if they differ.
+        size_t ref_size = ref_->GetSize();
+        size_t data_size = data_->GetSize();
+        size_ = std::min(ref_size, data_size);
+        size_t chunks = (size_ + kChunkSize - 1) / kChunkSize;
+        partials_.clear();
+        partials_.reserve(chunks);
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            partials_.emplace_back(kEps);
+            partials_.back().SetTopRows(top_rows_);
+            partials_.back().SetQuantiles(quantiles_);
+            partials_.back().SetFirstRow(chunk * kChunkSize);
+        }
+    }
+    size_t GetNumberOfChunks() const {
+        return partials_.size();
+    }
+    void CalculateChunk(const size_t chunk) {
+        // Partial result for rows of a single chunk; chunks are independent.
+        size_t offset = chunk * kChunkSize;
+        size_t count = size_ - offset;
+        if (count > kChunkSize) {
+            count = kChunkSize;
+        }
+        partials_[chunk].AddValues(ref_->GetData() + offset, data_->GetData() + offset, count);
+    }
+    void Combine() {
+        // Merge partial results in row order.
+        acc_.Reset();
+        for (auto & partial : partials_) {
+            acc_.Merge(partial);
+        }
+        partials_.clear();
+        SetResults();
+    }
+    void Add(const double& ref_value, const double& data_value) {
+        // Accumulate a single value pair, when columns are not stored. Pairs
+        // go through the same blocks and chunks as stored columns, so results
+        // are identical.
+        ref_block_.push_back(ref_value);
+        data_block_.push_back(data_value);
+        if (ref_block_.size() == DiffAccumulator::kBlockSize) {
+            FlushBlock();
+        }
+    }
+    void Finish() {
+        // Calculate statistics from streamed values.
+        FlushBlock();
+        if (chunk_size_ > 0) {
+            acc_.Merge(chunk_);
+            chunk_.Reset();
+            chunk_size_ = 0;
+        }
+        SetResults();
+    }
+
+private:
+    void FlushBlock() {
+        chunk_.AddValues(ref_block_.data(), data_block_.data(), ref_block_.size());
+        chunk_size_ += ref_block_.size();
+        ref_block_.clear();
+        data_block_.clear();
+        if (chunk_size_ == kChunkSize) {
+            acc_.Merge(chunk_);
+            chunk_.Reset();
+            chunk_.SetFirstRow(acc_.GetCount());
+            chunk_size_ = 0;
+        }
+    }
+    void SetResults() {
+        // Calculate statistics from accumulated values.
+        acc_.GetMinMax(min_diff_abs_, max_diff_abs_);
+        acc_.GetStat(mean_diff_, var_diff_);
+        acc_.GetStatAbs(mean_diff_abs_, var_diff_abs_);
+        // Calculate standard deviation.
+        sd_diff_ = std::sqrt(var_diff_);
+        // Calculate standard deviation (absolute).
+        sd_diff_abs_ = std::sqrt(var_diff_abs_);
+
+        ready_ = true;
+    }
 };
 
 typedef std::shared_ptr<CsvStats> CsvStatPtr;
@@ -0,0 +1,114 @@
+#ifndef CSV_SUMMARY_HPP
+#define CSV_SUMMARY_HPP
+
+#include "CsvReport.hpp"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// One line per compared file pair, with column counts by result and the
+// overall status of the pair; used by the batch and directory modes.
+class CsvSummary {
+public:
+    enum Status {
+        kSame,
+        kDiffers,
+        kMissing,
+        kError
+    };
+
+private:
+    struct Row {
+        std::string name;
+        Status status;
+        size_t compared;
+        size_t same;
+        size_t nan;
+        size_t ref_lines;
+        size_t data_lines;
+    };
+    std::vector<Row> rows_;
+
+public:
+    CsvSummary() {}
+    ~CsvSummary() {}
+    static Status GetStatus(const CsvReport& report) {
+        // No compared columns means a file could not be read or has no common columns.
+        size_t compared = report.GetComparedCount();
+        if (compared == 0) {
+            return kError;
+        }
+        if (report.GetSameCount() != compared || report.HasRowMismatch()) {
+            return kDiffers;
+        }
+        return kSame;
+    }
+    static const char* GetStatusName(const Status status) {
+        switch (status) {
+        case kSame: return "Same";
+        case kDiffers: return "Differs";
+        case kMissing: return "Missing";
+        default: return "Error";
+        }
+    }
+    void Add(const std::string& name, const CsvReport& report) {
+        Row row;
+        row.name = name;
+        row.status = GetStatus(report);
+        row.compared = report.GetComparedCount();
+        row.same = report.GetSameCount();
+        row.nan = report.GetNanCount();
+        row.ref_lines = report.GetRefLineCount();
+        row.data_lines = report.GetDataLineCount();
+        rows_.push_back(row);
+    }
+    void AddMissing(const std::string& name) {
+        // File pair with only one side present.
+        Row row = { name, kMissing, 0, 0, 0, 0, 0 };
+        rows_.push_back(row);
+    }
+    size_t GetCount(const Status status) const {
+        size_t count = 0;
+        for (auto & row : rows_) {
+            if (row.status == status) {
+                ++count;
+            }
+        }
+        return count;
+    }
+    int GetExitStatus() const {
+        // As for --gate: 0 if all pairs are the same, 2 if any differs, and 1
+        // if any is missing or could not be compared.
+        if (GetCount(kMissing) > 0 || GetCount(kError) > 0) {
+            return 1;
+        }
+        return GetCount(kDiffers) > 0 ? 2 : 0;
+    }
+    void Show(const std::string& title) const {
+        char buf[1024];
+        std::cout << "\n== Summary; " << title << " ==\n";
+        snprintf(buf, sizeof(buf), "%-32s : %8s %8s %8s %8s %10s %10s %s"
+            , "File", "Columns", "Same", "NaN", "Differ", "RefLines", "DataLines", "Result");
+        std::cout << buf << "\n";
+        for (auto & row : rows_) {
+            snprintf(buf, sizeof(buf), "%-32s : %8zu %8zu %8zu %8zu %10zu %10zu %s"
+                , row.name.c_str()
+                , row.compared, row.same, row.nan, row.compared - row.same - row.nan
+                , row.ref_lines, row.data_lines
+                , GetStatusName(row.status)
+            );
+            std::cout << buf << "\n";
+        }
+        if (rows_.size() > 1) {
+            std::cout << "\nSame : " << GetCount(kSame)
+                << " Differs : " << GetCount(kDiffers)
+                << " Missing : " << GetCount(kMissing)
+                << " Error : " << GetCount(kError)
+                << " / " << rows_.size() << "\n";
+        }
+    }
+};
+
+#endif // CSV_SUMMARY_HPP
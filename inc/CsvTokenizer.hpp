@@ -0,0 +1,102 @@
+#ifndef CSV_TOKENIZER_HPP
+#define CSV_TOKENIZER_HPP
+
+#include "NumberParser.hpp"
+#include "StructuralIndex.hpp"
+
+#include <string>
+#include <cstring>
+#include <vector>
+
+// Per field flag, non-zero for fields to be delivered.
+typedef std::vector<char> FieldMask;
+
+class CsvTokenizer {
+public:
+    static bool IsSpace(const char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+    static const char* FindLineEnd(const char* pos, const char* end) {
+        // Return position of the next '\n', or end of buffer.
+        auto found = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        return found ? found : end;
+    }
+    static const char* NextLine(const char* line_end, const char* end) {
+        // Step over the '\n' terminating a line, if any.
+        return line_end < end ? line_end + 1 : end;
+    }
+    static size_t CountLines(const char* pos, const char* end) {
+        // Upper bound for the number of lines in the buffer.
+        size_t count = 0;
+        while (pos < end) {
+            pos = NextLine(FindLineEnd(pos, end), end);
+            ++count;
+        }
+        return count;
+    }
+    static bool IsBlank(const char* begin, const char* end) {
+        for (auto p = begin; p < end; ++p) {
+            if (! IsSpace(*p)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    template <typename Fun>
+    static void ForEachField(const char* begin, const char* end, const FieldMask* mask, Fun&& fun) {
+        // Iterate over the comma separated values in a line, calling
+        // fun(index, begin, end). Whitespace (space, \t, \r) is not part of a
+        // value, empty values are omitted. Fields not in mask are only checked
+        // for being empty, to keep the index right. Commas and whitespace are
+        // located once for the whole line, see StructuralIndex.
+        static thread_local StructuralIndex structure;
+        const size_t size = end - begin;
+        structure.Build(begin, size);
+        size_t field = 0;
+        size_t index = 0;
+        for (;;) {
+            const size_t comma = structure.NextComma(field);
+            if (mask && (index >= mask->size() || ! (*mask)[index])) {
+                if (structure.FirstNonSpace(field, comma) < comma) {
+                    ++index;
+                }
+            } else if (EmitField(structure, begin, field, comma, index, fun)) {
+                ++index;
+            }
+            if (comma == size) {
+                break;
+            }
+            field = comma + 1;
+        }
+    }
+    static double ToDouble(const char* begin, const char* end) {
+        // Convert a stripped field to double, NaN if it is not a number.
+        return NumberParser::Parse(begin, end);
+    }
+
+private:
+    template <typename Fun>
+    static bool EmitField(const StructuralIndex& structure, const char* line, size_t begin, size_t end, const size_t index, Fun& fun) {
+        // Trim surrounding whitespace.
+        begin = structure.FirstNonSpace(begin, end);
+        if (begin == end) {
+            return false;
+        }
+        end = structure.LastNonSpace(begin, end) + 1;
+        // Whitespace inside a value is dropped as well; rare, so copy only then.
+        if (structure.HasSpace(begin, end)) {
+            std::string stripped;
+            for (auto q = line + begin; q < line + end; ++q) {
+                if (! IsSpace(*q)) {
+                    stripped += *q;
+                }
+            }
+            fun(index, stripped.data(), stripped.data() + stripped.size());
+            return true;
+        }
+        fun(index, line + begin, line + end);
+        return true;
+    }
+};
+
+#endif // CSV_TOKENIZER_HPP
@@ -0,0 +1,382 @@
+#ifndef DECOMPRESS_STREAM_HPP
+#define DECOMPRESS_STREAM_HPP
+
+#include "MappedFile.hpp"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef CSVDIFF_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CSVDIFF_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// Reads a gzip or zstd file, or a pipe, on a thread of its own, handing out
+// the (expanded) data in blocks. At most a few blocks are queued, so memory
+// use is bounded and reading overlaps with parsing of earlier blocks.
+// Pipes ("-" for stdin, named pipes) are read sequentially, as they arrive;
+// they may be compressed as well.
+class DecompressStream {
+public:
+    enum Format {
+        kNone,
+        kGzip,
+        kZstd
+    };
+
+private:
+    static const size_t kBlockSize = 1 << 20;
+    static const size_t kMaxBlocks = 4;
+    std::string filename_;
+    MappedFile file_;
+    // Descriptor of a pipe, -1 for mapped files.
+    int fd_;
+    bool mapped_read_;
+    // Input bytes already read from a pipe to detect its format.
+    std::vector<char> pending_;
+    std::vector<char> input_;
+    Format format_;
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::vector<char>> blocks_;
+    bool done_;
+    bool stop_;
+    // Input ended early or was corrupt.
+    bool failed_;
+
+public:
+    DecompressStream(const std::string& filename)
+    : filename_(filename)
+    , file_(filename)
+    , fd_(-1)
+    , mapped_read_(false)
+    , format_(kNone)
+    , done_(false)
+    , stop_(false)
+    , failed_(false)
+    {}
+    ~DecompressStream() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        if (fd_ > STDIN_FILENO) {
+            ::close(fd_);
+        }
+    }
+    DecompressStream(const DecompressStream&) = delete;
+    DecompressStream& operator=(const DecompressStream&) = delete;
+    static bool IsPipe(const std::string& filename) {
+        // Standard input, or anything else which is not a regular file.
+        if (filename == "-" || filename == "/dev/stdin") {
+            return true;
+        }
+        struct stat st;
+        return ::stat(filename.c_str(), &st) == 0 && ! S_ISREG(st.st_mode) && ! S_ISDIR(st.st_mode);
+    }
+    static bool IsStream(const std::string& filename) {
+        // Input which is not read from a mapping of the file.
+        return IsPipe(filename) || Detect(filename) != kNone;
+    }
+    static Format Detect(const std::string& filename) {
+        // Compressed files are recognized by their magic bytes, not by name.
+        char magic[4] = { 0, 0, 0, 0 };
+        std::ifstream f(filename, std::ios::binary);
+        f.read(magic, sizeof(magic));
+        return Detect(magic, static_cast<size_t>(f.gcount()));
+    }
+    static Format Detect(const char* data, const size_t size) {
+        const unsigned char* magic = reinterpret_cast<const unsigned char*>(data);
+        if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+            return kGzip;
+        }
+        if (size >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+            return kZstd;
+        }
+        return kNone;
+    }
+    static bool IsSupported(const Format format) {
+        switch (format) {
+        case kNone: return true;
+#ifdef CSVDIFF_HAVE_ZLIB
+        case kGzip: return true;
+#endif
+#ifdef CSVDIFF_HAVE_ZSTD
+        case kZstd: return true;
+#endif
+        default: return false;
+        }
+    }
+    static const char* GetFormatName(const Format format) {
+        return format == kGzip ? "gzip" : format == kZstd ? "zstd" : "none";
+    }
+    bool Start() {
+        if (IsPipe(filename_)) {
+            if (filename_ == "-" || filename_ == "/dev/stdin") {
+                fd_ = STDIN_FILENO;
+            } else {
+                fd_ = ::open(filename_.c_str(), O_RDONLY);
+                if (fd_ < 0) {
+                    return false;
+                }
+            }
+            // Format of a pipe is known from its first bytes only; keep them.
+            pending_.resize(4);
+            size_t size = 0;
+            while (size < pending_.size()) {
+                ssize_t n = ::read(fd_, pending_.data() + size, pending_.size() - size);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    break;
+                }
+                size += static_cast<size_t>(n);
+            }
+            pending_.resize(size);
+            format_ = Detect(pending_.data(), pending_.size());
+        } else {
+            format_ = Detect(filename_);
+            if (IsSupported(format_) && ! file_.Open()) {
+                return false;
+            }
+        }
+        if (! IsSupported(format_)) {
+            std::cerr << "No " << GetFormatName(format_) << " support for " << filename_ << "\n";
+            return false;
+        }
+        worker_ = std::thread([this]{ Run(); });
+        return true;
+    }
+    bool Read(std::vector<char>& block) {
+        // Next block of data; false at the end of the stream.
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]{ return done_ || ! blocks_.empty(); });
+        if (blocks_.empty()) {
+            return false;
+        }
+        block.swap(blocks_.front());
+        blocks_.pop_front();
+        cv_.notify_all();
+        return true;
+    }
+    bool Failed() const {
+        // True if the stream ended on an error rather than at the end of its
+        // input; set before Read() returns false.
+        return failed_;
+    }
+
+private:
+    void Run() {
+        bool ok = false;
+        if (format_ == kGzip) {
+            ok = InflateGzip();
+        } else if (format_ == kZstd) {
+            ok = DecompressZstd();
+        } else {
+            ok = CopyInput();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (! ok && ! stop_) {
+            std::cerr << "Unable to read " << filename_ << "\n";
+            failed_ = true;
+        }
+        done_ = true;
+        cv_.notify_all();
+    }
+    bool Stopped() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stop_;
+    }
+    bool Push(std::vector<char>& block) {
+        // Wait for room in the queue; false if the reader has gone.
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]{ return stop_ || blocks_.size() < kMaxBlocks; });
+        if (stop_) {
+            return false;
+        }
+        blocks_.push_back(std::move(block));
+        cv_.notify_all();
+        return true;
+    }
+    bool NextInput(const char*& data, size_t& size) {
+        // Next piece of raw input: all of a mapped file at once, a pipe in
+        // blocks as they arrive. False at the end of the input.
+        if (fd_ < 0) {
+            if (mapped_read_ || file_.Size() == 0) {
+                return false;
+            }
+            mapped_read_ = true;
+            data = file_.Begin();
+            size = file_.Size();
+            return true;
+        }
+        if (! pending_.empty()) {
+            input_.swap(pending_);
+            pending_.clear();
+            data = input_.data();
+            size = input_.size();
+            return true;
+        }
+        input_.resize(kBlockSize);
+        for (;;) {
+            // Wait in short steps, so a reader which has gone is noticed
+            // while the writer of the pipe is still busy.
+            struct pollfd pfd = { fd_, POLLIN, 0 };
+            int ready = ::poll(&pfd, 1, 100);
+            if (ready == 0 || (ready < 0 && errno == EINTR)) {
+                if (Stopped()) {
+                    return false;
+                }
+                continue;
+            }
+            ssize_t n = ::read(fd_, input_.data(), input_.size());
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            data = input_.data();
+            size = static_cast<size_t>(n);
+            return true;
+        }
+    }
+    bool CopyInput() {
+        // Uncompressed pipe; blocks are passed on as read.
+        const char* data;
+        size_t size;
+        while (NextInput(data, size)) {
+            std::vector<char> block(data, data + size);
+            if (! Push(block)) {
+                break;
+            }
+        }
+        return true;
+    }
+#ifdef CSVDIFF_HAVE_ZLIB
+    bool Feed(z_stream& z, const char*& in, const char*& end) {
+        // Hand the next input to zlib; avail_in is 32 bit, so in pieces.
+        if (in == end) {
+            size_t size;
+            if (! NextInput(in, size)) {
+                return false;
+            }
+            end = in + size;
+        }
+        size_t size = static_cast<size_t>(end - in);
+        if (size > (1u << 30)) {
+            size = 1u << 30;
+        }
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+        z.avail_in = static_cast<uInt>(size);
+        in += size;
+        return true;
+    }
+#endif
+    bool InflateGzip() {
+#ifdef CSVDIFF_HAVE_ZLIB
+        z_stream z;
+        std::memset(&z, 0, sizeof(z));
+        // Window bits 15 + 32: gzip or zlib header, detected automatically.
+        if (inflateInit2(&z, 15 + 32) != Z_OK) {
+            return false;
+        }
+        const char* in = nullptr;
+        const char* end = nullptr;
+        bool input_end = false;
+        bool ok = true;
+        for (;;) {
+            if (z.avail_in == 0 && ! Feed(z, in, end)) {
+                input_end = true;
+            }
+            std::vector<char> block(kBlockSize);
+            z.next_out = reinterpret_cast<Bytef*>(block.data());
+            z.avail_out = static_cast<uInt>(block.size());
+            int ret = inflate(&z, Z_NO_FLUSH);
+            block.resize(block.size() - z.avail_out);
+            if (! block.empty() && ! Push(block)) {
+                break;
+            }
+            if (ret == Z_STREAM_END) {
+                if (z.avail_in == 0 && ! Feed(z, in, end)) {
+                    break;
+                }
+                // Concatenated gzip members, e.g. from appending to a .gz file.
+                inflateReset(&z);
+            } else if (ret != Z_OK && ! (ret == Z_BUF_ERROR && ! input_end)) {
+                // Corrupt or truncated input.
+                ok = false;
+                break;
+            }
+        }
+        inflateEnd(&z);
+        return ok;
+#else
+        return false;
+#endif
+    }
+    bool DecompressZstd() {
+#ifdef CSVDIFF_HAVE_ZSTD
+        ZSTD_DCtx* ctx = ZSTD_createDCtx();
+        if (ctx == nullptr) {
+            return false;
+        }
+        ZSTD_inBuffer in = { nullptr, 0, 0 };
+        size_t ret = 0;
+        bool full = false;
+        bool ok = true;
+        for (;;) {
+            // More input is needed only once the decoder has no output left.
+            if (in.pos == in.size && ! full) {
+                const char* data;
+                size_t size;
+                if (! NextInput(data, size)) {
+                    break;
+                }
+                in.src = data;
+                in.size = size;
+                in.pos = 0;
+            }
+            std::vector<char> block(kBlockSize);
+            ZSTD_outBuffer out = { block.data(), block.size(), 0 };
+            ret = ZSTD_decompressStream(ctx, &out, &in);
+            if (ZSTD_isError(ret)) {
+                ok = false;
+                break;
+            }
+            full = out.pos == out.size;
+            block.resize(out.pos);
+            if (! block.empty() && ! Push(block)) {
+                break;
+            }
+        }
+        ZSTD_freeDCtx(ctx);
+        // Non-zero means the last frame is incomplete.
+        return ok && ret == 0;
+#else
+        return false;
+#endif
+    }
+};
+
+#endif // DECOMPRESS_STREAM_HPP
@@ -0,0 +1,178 @@
+#ifndef DIFF_ACCUMULATOR_HPP
+#define DIFF_ACCUMULATOR_HPP
+
+#include "DiffKernel.hpp"
+#include "Moments.hpp"
+#include "QuantileSketch.hpp"
+#include "TopRows.hpp"
+
+#include <cmath>
+#include <cstddef>
+
+class DiffAccumulator {
+public:
+    // Values per kernel block; both passes over a block stay in cache.
+    static const size_t kBlockSize = 256;
+
+private:
+    const double kEps;
+    double min_diff_abs_;
+    double max_diff_abs_;
+    Moments diff_;
+    Moments diff_abs_;
+    // Rows with largest differences, if tracked; rows are numbered from first_row_.
+    TopRows top_;
+    size_t first_row_;
+    // Distribution of absolute differences, if tracked; NaN differences are left out.
+    bool quantiles_;
+    QuantileSketch sketch_;
+
+public:
+    DiffAccumulator(const double& eps)
+    : kEps(eps)
+    , first_row_(0)
+    , quantiles_(false)
+    {
+        Reset();
+    }
+    ~DiffAccumulator() {}
+    void Reset() {
+        min_diff_abs_ = 1e30;
+        max_diff_abs_ = -1e30;
+        diff_ = Moments();
+        diff_abs_ = Moments();
+        top_.Clear();
+        sketch_.Clear();
+    }
+    void SetTopRows(const size_t count) {
+        top_.SetSize(count);
+    }
+    void SetQuantiles(const bool quantiles) {
+        quantiles_ = quantiles;
+    }
+    void SetFirstRow(const size_t row) {
+        first_row_ = row;
+    }
+    void Add(const double& ref_value, const double& data_value) {
+        // Calculate difference between reference and data values.
+        double diff;
+        if (std::isnan(ref_value) && std::isnan(data_value)) {
+            diff = 0.0;
+        } else {
+            diff = ref_value - data_value;
+        }
+        // Calculate absolute difference.
+        double diff_abs = std::fabs(diff);
+        // If difference is smaller than epsilon, assume it is zero.
+        if (diff_abs < kEps) {
+            diff_abs = 0.0;
+            diff = 0.0;
+        }
+        // Find mix/max for difference (absolute) values.
+        if (diff_abs < min_diff_abs_) {
+            min_diff_abs_ = diff_abs;
+        }
+        if (diff_abs > max_diff_abs_) {
+            max_diff_abs_ = diff_abs;
+        }
+        if (top_.GetSize() > 0) {
+            top_.Add(first_row_ + diff_.GetCount(), ref_value, data_value, kEps);
+        }
+        if (quantiles_ && ! std::isnan(diff_abs)) {
+            sketch_.Add(diff_abs);
+        }
+        diff_.Add(diff);
+        diff_abs_.Add(diff_abs);
+    }
+    void AddValues(const double* ref_values, const double* data_values, const size_t size) {
+        // Accumulate contiguous value pairs with the vectorized kernel, in blocks.
+        // First pass gives the block mean, second pass the squared deviations from it.
+        for (size_t offset = 0; offset < size; offset += kBlockSize) {
+            size_t count = size - offset;
+            if (count > kBlockSize) {
+                count = kBlockSize;
+            }
+            const double* ref_block = ref_values + offset;
+            const double* data_block = data_values + offset;
+            DiffKernel::Sums sums;
+            DiffKernel::Center center = { 0.0, 0.0 };
+            DiffKernel::Run(ref_block, data_block, count, kEps, center, sums);
+            center.diff = sums.sum / count;
+            center.diff_abs = sums.sum_abs / count;
+            DiffKernel::Sums deviations;
+            DiffKernel::Run(ref_block, data_block, count, kEps, center, deviations);
+
+            // Blocks without a difference larger than the tracked rows are skipped.
+            if (top_.GetSize() > 0 && ! top_.CanSkip(sums.max, std::isnan(sums.sum))) {
+                top_.AddValues(first_row_ + diff_.GetCount(), ref_block, data_block, count, kEps);
+            }
+            if (quantiles_) {
+                AddToSketch(ref_block, data_block, count);
+            }
+
+            if (sums.min < min_diff_abs_) {
+                min_diff_abs_ = sums.min;
+            }
+            if (sums.max > max_diff_abs_) {
+                max_diff_abs_ = sums.max;
+            }
+            diff_.Merge(Moments(count, center.diff, deviations.sum_sq));
+            diff_abs_.Merge(Moments(count, center.diff_abs, deviations.sum_abs_sq));
+        }
+    }
+    void Merge(const DiffAccumulator& other) {
+        // Combine with partial results of another part of the same column.
+        if (other.min_diff_abs_ < min_diff_abs_) {
+            min_diff_abs_ = other.min_diff_abs_;
+        }
+        if (other.max_diff_abs_ > max_diff_abs_) {
+            max_diff_abs_ = other.max_diff_abs_;
+        }
+        diff_.Merge(other.diff_);
+        diff_abs_.Merge(other.diff_abs_);
+        top_.Merge(other.top_);
+        sketch_.Merge(other.sketch_);
+    }
+    size_t GetCount() const {
+        return diff_.GetCount();
+    }
+    const TopRows& GetTopRows() const {
+        return top_;
+    }
+    const QuantileSketch& GetSketch() const {
+        return sketch_;
+    }
+    void GetMinMax(double& min, double& max) const {
+        min = min_diff_abs_;
+        max = max_diff_abs_;
+    }
+    void GetStat(double& mean, double& var) const {
+        // Mean and variance of differences.
+        mean = diff_.GetMean();
+        var = diff_.GetVariance();
+    }
+    void GetStatAbs(double& mean, double& var) const {
+        // Mean and variance of absolute differences.
+        mean = diff_abs_.GetMean();
+        var = diff_abs_.GetVariance();
+    }
+
+private:
+    void AddToSketch(const double* ref_values, const double* data_values, const size_t size) {
+        // Absolute differences as the kernel calculates them.
+        for (size_t i = 0; i < size; ++i) {
+            double diff_abs = 0.0;
+            if (! (std::isnan(ref_values[i]) && std::isnan(data_values[i]))) {
+                diff_abs = std::fabs(ref_values[i] - data_values[i]);
+            }
+            if (diff_abs < kEps) {
+                diff_abs = 0.0;
+            }
+            if (! std::isnan(diff_abs)) {
+                sketch_.Add(diff_abs);
+            }
+        }
+    }
+};
+
+#endif // DIFF_ACCUMULATOR_HPP
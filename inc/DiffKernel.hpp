@@ -0,0 +1,302 @@
+#ifndef DIFF_KERNEL_HPP
+#define DIFF_KERNEL_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DIFF_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+// Difference statistics kernel over contiguous reference/data values.
+// Squares are summed as deviations from a given center (the mean, on a
+// second pass over the same block).
+//
+// Sums are kept in 8 lanes (element i goes to lane i % 8) and reduced in a
+// fixed order, whatever the instruction set. SSE2 uses 4 registers of 2 lanes,
+// AVX2 2 registers of 4 lanes, AVX-512 a single register, and the scalar
+// code emulates the same lanes; so all targets give bit identical results.
+class DiffKernel {
+public:
+    static const size_t kLanes = 8;
+    enum Target {
+        kScalar = 0,
+        kSse2,
+        kAvx2,
+        kAvx512
+    };
+    struct Lanes {
+        double min[kLanes];
+        double max[kLanes];
+        double sum[kLanes];
+        double sum_abs[kLanes];
+        double sum_sq[kLanes];
+        double sum_abs_sq[kLanes];
+    };
+    struct Sums {
+        double min;
+        double max;
+        double sum;
+        double sum_abs;
+        double sum_sq;
+        double sum_abs_sq;
+    };
+    struct Center {
+        double diff;
+        double diff_abs;
+    };
+
+    static Target GetTarget() {
+        static const Target target = DetectTarget();
+        return target;
+    }
+    static const char* GetTargetName(const Target target) {
+        switch (target) {
+            case kSse2: return "sse2";
+            case kAvx2: return "avx2";
+            case kAvx512: return "avx512";
+            default: return "scalar";
+        }
+    }
+    static void Run(const double* ref, const double* data, const size_t size, const double eps, const Center& center, Sums& sums) {
+        Run(GetTarget(), ref, data, size, eps, center, sums);
+    }
+    static void Run(const Target target, const double* ref, const double* data, const size_t size, const double eps, const Center& center, Sums& sums) {
+        // Calculate min/max, sums and squared deviations of (absolute) differences for size values.
+        Lanes lanes;
+        Init(lanes);
+        size_t done = 0;
+        switch (target) {
+#ifdef DIFF_KERNEL_X86
+            case kAvx512: done = RunAvx512(ref, data, size, eps, center, lanes); break;
+            case kAvx2: done = RunAvx2(ref, data, size, eps, center, lanes); break;
+            case kSse2: done = RunSse2(ref, data, size, eps, center, lanes); break;
+#endif
+            default: break;
+        }
+        // Remaining values (all of them for scalar) go to their lanes one by one.
+        for (size_t i = done; i < size; ++i) {
+            Step(lanes, i % kLanes, ref[i], data[i], eps, center);
+        }
+        Reduce(lanes, sums);
+    }
+
+private:
+    static Target DetectTarget() {
+        Target target = kScalar;
+#ifdef DIFF_KERNEL_X86
+        target = kSse2;
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            target = kAvx2;
+        }
+        if (__builtin_cpu_supports("avx512f")) {
+            target = kAvx512;
+        }
+#endif
+        // Allow a lower target to be forced, e.g. CSVDIFF_SIMD=scalar.
+        const char* forced = std::getenv("CSVDIFF_SIMD");
+        if (forced) {
+            for (int t = kScalar; t < target; ++t) {
+                if (std::strcmp(forced, GetTargetName(static_cast<Target>(t))) == 0) {
+                    target = static_cast<Target>(t);
+                }
+            }
+        }
+        return target;
+    }
+    static void Init(Lanes& lanes) {
+        for (size_t l = 0; l < kLanes; ++l) {
+            lanes.min[l] = 1e30;
+            lanes.max[l] = -1e30;
+            lanes.sum[l] = lanes.sum_abs[l] = 0.0;
+            lanes.sum_sq[l] = lanes.sum_abs_sq[l] = 0.0;
+        }
+    }
+    static void Step(Lanes& lanes, const size_t l, const double ref_value, const double data_value, const double eps, const Center& center) {
+        // Calculate difference between reference and data values.
+        double diff;
+        if (std::isnan(ref_value) && std::isnan(data_value)) {
+            diff = 0.0;
+        } else {
+            diff = ref_value - data_value;
+        }
+        double diff_abs = std::fabs(diff);
+        // If difference is smaller than epsilon, assume it is zero.
+        if (diff_abs < eps) {
+            diff_abs = 0.0;
+            diff = 0.0;
+        }
+        if (diff_abs < lanes.min[l]) {
+            lanes.min[l] = diff_abs;
+        }
+        if (diff_abs > lanes.max[l]) {
+            lanes.max[l] = diff_abs;
+        }
+        lanes.sum[l] += diff;
+        lanes.sum_abs[l] += diff_abs;
+        double dev = diff - center.diff;
+        double dev_abs = diff_abs - center.diff_abs;
+        lanes.sum_sq[l] += dev * dev;
+        lanes.sum_abs_sq[l] += dev_abs * dev_abs;
+    }
+    static double ReduceSum(const double* v) {
+        return ((v[0] + v[1]) + (v[2] + v[3])) + ((v[4] + v[5]) + (v[6] + v[7]));
+    }
+    static void Reduce(const Lanes& lanes, Sums& sums) {
+        sums.min = 1e30;
+        sums.max = -1e30;
+        for (size_t l = 0; l < kLanes; ++l) {
+            if (lanes.min[l] < sums.min) {
+                sums.min = lanes.min[l];
+            }
+            if (lanes.max[l] > sums.max) {
+                sums.max = lanes.max[l];
+            }
+        }
+        sums.sum = ReduceSum(lanes.sum);
+        sums.sum_abs = ReduceSum(lanes.sum_abs);
+        sums.sum_sq = ReduceSum(lanes.sum_sq);
+        sums.sum_abs_sq = ReduceSum(lanes.sum_abs_sq);
+    }
+
+#ifdef DIFF_KERNEL_X86
+    static size_t RunSse2(const double* ref, const double* data, const size_t size, const double eps, const Center& center, Lanes& lanes) {
+        const __m128d v_eps = _mm_set1_pd(eps);
+        const __m128d v_sign = _mm_set1_pd(-0.0);
+        const __m128d v_center = _mm_set1_pd(center.diff);
+        const __m128d v_center_abs = _mm_set1_pd(center.diff_abs);
+        __m128d v_min[4], v_max[4], v_sum[4], v_sum_abs[4], v_sum_sq[4], v_sum_abs_sq[4];
+        for (int k = 0; k < 4; ++k) {
+            v_min[k] = _mm_loadu_pd(lanes.min + 2 * k);
+            v_max[k] = _mm_loadu_pd(lanes.max + 2 * k);
+            v_sum[k] = _mm_loadu_pd(lanes.sum + 2 * k);
+            v_sum_abs[k] = _mm_loadu_pd(lanes.sum_abs + 2 * k);
+            v_sum_sq[k] = _mm_loadu_pd(lanes.sum_sq + 2 * k);
+            v_sum_abs_sq[k] = _mm_loadu_pd(lanes.sum_abs_sq + 2 * k);
+        }
+        size_t i = 0;
+        for (; i + kLanes <= size; i += kLanes) {
+            for (int k = 0; k < 4; ++k) {
+                __m128d r = _mm_loadu_pd(ref + i + 2 * k);
+                __m128d d = _mm_loadu_pd(data + i + 2 * k);
+                // NaN == NaN counts as no difference.
+                __m128d both_nan = _mm_and_pd(_mm_cmpunord_pd(r, r), _mm_cmpunord_pd(d, d));
+                __m128d diff = _mm_andnot_pd(both_nan, _mm_sub_pd(r, d));
+                __m128d diff_abs = _mm_andnot_pd(v_sign, diff);
+                // Zero differences below epsilon; NaN compares false and is kept.
+                __m128d small = _mm_cmplt_pd(diff_abs, v_eps);
+                diff = _mm_andnot_pd(small, diff);
+                diff_abs = _mm_andnot_pd(small, diff_abs);
+                // min/max return the second operand for NaN, so NaN is skipped.
+                v_min[k] = _mm_min_pd(diff_abs, v_min[k]);
+                v_max[k] = _mm_max_pd(diff_abs, v_max[k]);
+                v_sum[k] = _mm_add_pd(v_sum[k], diff);
+                v_sum_abs[k] = _mm_add_pd(v_sum_abs[k], diff_abs);
+                __m128d dev = _mm_sub_pd(diff, v_center);
+                __m128d dev_abs = _mm_sub_pd(diff_abs, v_center_abs);
+                v_sum_sq[k] = _mm_add_pd(v_sum_sq[k], _mm_mul_pd(dev, dev));
+                v_sum_abs_sq[k] = _mm_add_pd(v_sum_abs_sq[k], _mm_mul_pd(dev_abs, dev_abs));
+            }
+        }
+        for (int k = 0; k < 4; ++k) {
+            _mm_storeu_pd(lanes.min + 2 * k, v_min[k]);
+            _mm_storeu_pd(lanes.max + 2 * k, v_max[k]);
+            _mm_storeu_pd(lanes.sum + 2 * k, v_sum[k]);
+            _mm_storeu_pd(lanes.sum_abs + 2 * k, v_sum_abs[k]);
+            _mm_storeu_pd(lanes.sum_sq + 2 * k, v_sum_sq[k]);
+            _mm_storeu_pd(lanes.sum_abs_sq + 2 * k, v_sum_abs_sq[k]);
+        }
+        return i;
+    }
+    __attribute__((target("avx2")))
+    static size_t RunAvx2(const double* ref, const double* data, const size_t size, const double eps, const Center& center, Lanes& lanes) {
+        const __m256d v_eps = _mm256_set1_pd(eps);
+        const __m256d v_sign = _mm256_set1_pd(-0.0);
+        const __m256d v_center = _mm256_set1_pd(center.diff);
+        const __m256d v_center_abs = _mm256_set1_pd(center.diff_abs);
+        __m256d v_min[2], v_max[2], v_sum[2], v_sum_abs[2], v_sum_sq[2], v_sum_abs_sq[2];
+        for (int k = 0; k < 2; ++k) {
+            v_min[k] = _mm256_loadu_pd(lanes.min + 4 * k);
+            v_max[k] = _mm256_loadu_pd(lanes.max + 4 * k);
+            v_sum[k] = _mm256_loadu_pd(lanes.sum + 4 * k);
+            v_sum_abs[k] = _mm256_loadu_pd(lanes.sum_abs + 4 * k);
+            v_sum_sq[k] = _mm256_loadu_pd(lanes.sum_sq + 4 * k);
+            v_sum_abs_sq[k] = _mm256_loadu_pd(lanes.sum_abs_sq + 4 * k);
+        }
+        size_t i = 0;
+        for (; i + kLanes <= size; i += kLanes) {
+            for (int k = 0; k < 2; ++k) {
+                __m256d r = _mm256_loadu_pd(ref + i + 4 * k);
+                __m256d d = _mm256_loadu_pd(data + i + 4 * k);
+                __m256d both_nan = _mm256_and_pd(_mm256_cmp_pd(r, r, _CMP_UNORD_Q), _mm256_cmp_pd(d, d, _CMP_UNORD_Q));
+                __m256d diff = _mm256_andnot_pd(both_nan, _mm256_sub_pd(r, d));
+                __m256d diff_abs = _mm256_andnot_pd(v_sign, diff);
+                __m256d small = _mm256_cmp_pd(diff_abs, v_eps, _CMP_LT_OQ);
+                diff = _mm256_andnot_pd(small, diff);
+                diff_abs = _mm256_andnot_pd(small, diff_abs);
+                v_min[k] = _mm256_min_pd(diff_abs, v_min[k]);
+                v_max[k] = _mm256_max_pd(diff_abs, v_max[k]);
+                v_sum[k] = _mm256_add_pd(v_sum[k], diff);
+                v_sum_abs[k] = _mm256_add_pd(v_sum_abs[k], diff_abs);
+                __m256d dev = _mm256_sub_pd(diff, v_center);
+                __m256d dev_abs = _mm256_sub_pd(diff_abs, v_center_abs);
+                v_sum_sq[k] = _mm256_add_pd(v_sum_sq[k], _mm256_mul_pd(dev, dev));
+                v_sum_abs_sq[k] = _mm256_add_pd(v_sum_abs_sq[k], _mm256_mul_pd(dev_abs, dev_abs));
+            }
+        }
+        for (int k = 0; k < 2; ++k) {
+            _mm256_storeu_pd(lanes.min + 4 * k, v_min[k]);
+            _mm256_storeu_pd(lanes.max + 4 * k, v_max[k]);
+            _mm256_storeu_pd(lanes.sum + 4 * k, v_sum[k]);
+            _mm256_storeu_pd(lanes.sum_abs + 4 * k, v_sum_abs[k]);
+            _mm256_storeu_pd(lanes.sum_sq + 4 * k, v_sum_sq[k]);
+            _mm256_storeu_pd(lanes.sum_abs_sq + 4 * k, v_sum_abs_sq[k]);
+        }
+        return i;
+    }
+    __attribute__((target("avx512f")))
+    static size_t RunAvx512(const double* ref, const double* data, const size_t size, const double eps, const Center& center, Lanes& lanes) {
+        const __m512d v_eps = _mm512_set1_pd(eps);
+        const __m512d v_center = _mm512_set1_pd(center.diff);
+        const __m512d v_center_abs = _mm512_set1_pd(center.diff_abs);
+        __m512d v_min = _mm512_loadu_pd(lanes.min);
+        __m512d v_max = _mm512_loadu_pd(lanes.max);
+        __m512d v_sum = _mm512_loadu_pd(lanes.sum);
+        __m512d v_sum_abs = _mm512_loadu_pd(lanes.sum_abs);
+        __m512d v_sum_sq = _mm512_loadu_pd(lanes.sum_sq);
+        __m512d v_sum_abs_sq = _mm512_loadu_pd(lanes.sum_abs_sq);
+        size_t i = 0;
+        for (; i + kLanes <= size; i += kLanes) {
+            __m512d r = _mm512_loadu_pd(ref + i);
+            __m512d d = _mm512_loadu_pd(data + i);
+            __mmask8 both_nan = _mm512_cmp_pd_mask(r, r, _CMP_UNORD_Q) & _mm512_cmp_pd_mask(d, d, _CMP_UNORD_Q);
+            __m512d diff = _mm512_maskz_mov_pd(static_cast<__mmask8>(~both_nan), _mm512_sub_pd(r, d));
+            __m512d diff_abs = _mm512_abs_pd(diff);
+            __mmask8 keep = _mm512_cmp_pd_mask(diff_abs, v_eps, _CMP_NLT_UQ);
+            diff = _mm512_maskz_mov_pd(keep, diff);
+            diff_abs = _mm512_maskz_mov_pd(keep, diff_abs);
+            v_min = _mm512_min_pd(diff_abs, v_min);
+            v_max = _mm512_max_pd(diff_abs, v_max);
+            v_sum = _mm512_add_pd(v_sum, diff);
+            v_sum_abs = _mm512_add_pd(v_sum_abs, diff_abs);
+            __m512d dev = _mm512_sub_pd(diff, v_center);
+            __m512d dev_abs = _mm512_sub_pd(diff_abs, v_center_abs);
+            v_sum_sq = _mm512_add_pd(v_sum_sq, _mm512_mul_pd(dev, dev));
+            v_sum_abs_sq = _mm512_add_pd(v_sum_abs_sq, _mm512_mul_pd(dev_abs, dev_abs));
+        }
+        _mm512_storeu_pd(lanes.min, v_min);
+        _mm512_storeu_pd(lanes.max, v_max);
+        _mm512_storeu_pd(lanes.sum, v_sum);
+        _mm512_storeu_pd(lanes.sum_abs, v_sum_abs);
+        _mm512_storeu_pd(lanes.sum_sq, v_sum_sq);
+        _mm512_storeu_pd(lanes.sum_abs_sq, v_sum_abs_sq);
+        return i;
+    }
+#endif
+};
+
+#endif // DIFF_KERNEL_HPP
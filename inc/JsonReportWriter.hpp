@@ -0,0 +1,129 @@
+#ifndef JSON_REPORT_WRITER_HPP
+#define JSON_REPORT_WRITER_HPP
+
+#include "ReportWriter.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+// JSON Lines: a "report" object with the settings, one "column" object per
+// column and suggestion, and a closing "summary" object. NaN is null.
+// Absolute differences at the percentiles listed in "report" are given
+// under "percentiles", rows with largest differences under "top". With
+// rows paired on a key column, "report" has the key and match counts.
+class JsonReportWriter : public ReportWriter {
+public:
+    JsonReportWriter(std::ostream& out)
+    : ReportWriter(out)
+    {}
+    ~JsonReportWriter() {}
+    void Begin(const CsvResultTotals& totals) override {
+        out_ << "{\"type\":\"report\",\"eps\":";
+        WriteNumber(totals.eps);
+        out_ << ",\"columns\":" << totals.columns;
+        out_ << ",\"ref_lines\":" << totals.ref_lines;
+        out_ << ",\"data_lines\":" << totals.data_lines;
+        if (! totals.percentiles.empty()) {
+            out_ << ",\"percentiles\":[";
+            for (size_t i = 0; i < totals.percentiles.size(); ++i) {
+                out_ << (i == 0 ? "" : ",");
+                WriteNumber(totals.percentiles[i]);
+            }
+            out_ << "]";
+        }
+        if (totals.top_rows > 0) {
+            out_ << ",\"top_rows\":" << totals.top_rows;
+        }
+        if (! totals.key.empty()) {
+            out_ << ",\"key\":";
+            WriteString(totals.key);
+            out_ << ",\"join\":";
+            WriteString(totals.join_method);
+            out_ << ",\"matched\":" << totals.matched;
+            out_ << ",\"ref_unmatched\":" << totals.ref_unmatched;
+            out_ << ",\"data_unmatched\":" << totals.data_unmatched;
+        }
+        out_ << "}\n";
+    }
+    void WriteSuggestion(const std::string& ref_name, const std::string& data_name) override {
+        out_ << "{\"type\":\"suggestion\",\"ref\":";
+        WriteString(ref_name);
+        out_ << ",\"data\":";
+        WriteString(data_name);
+        out_ << "}\n";
+    }
+    void Write(const CsvResult& result) override {
+        out_ << "{\"type\":\"column\",\"name\":";
+        WriteString(result.name);
+        out_ << ",\"status\":\"" << CsvResult::GetStatusName(result.status) << "\"";
+        out_ << ",\"max\":";
+        WriteNumber(result.max);
+        out_ << ",\"min\":";
+        WriteNumber(result.min);
+        out_ << ",\"mean\":";
+        WriteNumber(result.mean);
+        out_ << ",\"sd\":";
+        WriteNumber(result.sd);
+        out_ << ",\"mean_abs\":";
+        WriteNumber(result.mean_abs);
+        out_ << ",\"sd_abs\":";
+        WriteNumber(result.sd_abs);
+        if (! result.percentiles.empty()) {
+            out_ << ",\"percentiles\":[";
+            for (size_t i = 0; i < result.percentiles.size(); ++i) {
+                out_ << (i == 0 ? "" : ",");
+                WriteNumber(result.percentiles[i]);
+            }
+            out_ << "]";
+        }
+        if (! result.top.empty()) {
+            out_ << ",\"top\":[";
+            for (size_t i = 0; i < result.top.size(); ++i) {
+                out_ << (i == 0 ? "{\"row\":" : ",{\"row\":") << result.top[i].row + 1;
+                out_ << ",\"data_row\":" << result.top[i].data_row + 1;
+                out_ << ",\"ref\":";
+                WriteNumber(result.top[i].ref);
+                out_ << ",\"data\":";
+                WriteNumber(result.top[i].data);
+                out_ << ",\"diff_abs\":";
+                WriteNumber(result.top[i].diff_abs);
+                out_ << "}";
+            }
+            out_ << "]";
+        }
+        out_ << "}\n";
+    }
+    void End(const CsvResultTotals& totals) override {
+        out_ << "{\"type\":\"summary\",\"compared\":" << totals.compared;
+        out_ << ",\"same\":" << totals.same;
+        out_ << ",\"nan\":" << totals.nan << "}\n";
+    }
+
+private:
+    void WriteNumber(const double value) {
+        if (! std::isfinite(value)) {
+            out_ << "null";
+            return;
+        }
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.17g", value);
+        out_ << buf;
+    }
+    void WriteString(const std::string& str) {
+        out_ << '"';
+        for (auto c : str) {
+            if (c == '"' || c == '\\') {
+                out_ << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+                out_ << buf;
+            } else {
+                out_ << c;
+            }
+        }
+        out_ << '"';
+    }
+};
+
+#endif // JSON_REPORT_WRITER_HPP
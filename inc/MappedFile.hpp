@@ -0,0 +1,114 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_USE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <vector>
+#endif
+
+class MappedFile {
+private:
+    std::string filename_;
+    const char* data_;
+    size_t size_;
+    bool open_;
+#ifdef MAPPED_FILE_USE_MMAP
+    void* map_;
+#else
+    std::vector<char> buffer_;
+#endif
+
+public:
+    MappedFile(const std::string& filename)
+    : filename_(filename)
+    , data_(nullptr)
+    , size_(0)
+    , open_(false)
+#ifdef MAPPED_FILE_USE_MMAP
+    , map_(nullptr)
+#endif
+    {}
+    ~MappedFile() {
+        Close();
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    bool Open() {
+        Close();
+#ifdef MAPPED_FILE_USE_MMAP
+        int fd = ::open(filename_.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            map_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map_ == MAP_FAILED) {
+                map_ = nullptr;
+                size_ = 0;
+                ::close(fd);
+                return false;
+            }
+            // File is walked front to back; let the kernel read ahead.
+            ::madvise(map_, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(map_);
+        }
+        // Mapping stays valid after the descriptor is closed.
+        ::close(fd);
+#else
+        std::ifstream f(filename_, std::ios::binary | std::ios::ate);
+        if (! f.good()) {
+            return false;
+        }
+        size_ = static_cast<size_t>(f.tellg());
+        buffer_.resize(size_);
+        f.seekg(0);
+        f.read(buffer_.data(), size_);
+        data_ = buffer_.data();
+#endif
+        open_ = true;
+        return true;
+    }
+    void Close() {
+#ifdef MAPPED_FILE_USE_MMAP
+        if (map_) {
+            ::munmap(map_, size_);
+            map_ = nullptr;
+        }
+#else
+        buffer_.clear();
+        buffer_.shrink_to_fit();
+#endif
+        data_ = nullptr;
+        size_ = 0;
+        open_ = false;
+    }
+    bool IsOpen() const {
+        return open_;
+    }
+    const char* Begin() const {
+        return data_;
+    }
+    const char* End() const {
+        return data_ + size_;
+    }
+    size_t Size() const {
+        return size_;
+    }
+};
+
+#endif // MAPPED_FILE_HPP
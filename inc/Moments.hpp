@@ -0,0 +1,79 @@
+#ifndef MOMENTS_HPP
+#define MOMENTS_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+// Count, mean and sum of squared deviations (M2) of a sequence of values.
+// Values are added with Welford's update, partial results are combined with
+// Chan's formula; neither subtracts large sums, so precision does not degrade
+// with the number of values.
+class Moments {
+private:
+    size_t count_;
+    double mean_;
+    double m2_;
+
+public:
+    Moments()
+    : count_(0)
+    , mean_(0.0)
+    , m2_(0.0)
+    {}
+    Moments(const size_t count, const double& mean, const double& m2)
+    : count_(count)
+    , mean_(mean)
+    , m2_(m2)
+    {}
+    ~Moments() {}
+    void Add(const double& value) {
+        ++count_;
+        if (std::isfinite(mean_) && std::isfinite(value)) {
+            double delta = value - mean_;
+            mean_ += delta / count_;
+            m2_ += delta * (value - mean_);
+        } else {
+            // inf/NaN propagate to the mean as they would in a plain sum.
+            mean_ += value;
+            m2_ = std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+    void Merge(const Moments& other) {
+        if (other.count_ == 0) {
+            return;
+        }
+        if (count_ == 0) {
+            *this = other;
+            return;
+        }
+        double count = static_cast<double>(count_ + other.count_);
+        if (std::isfinite(mean_) && std::isfinite(other.mean_)) {
+            double delta = other.mean_ - mean_;
+            mean_ += delta * (other.count_ / count);
+            m2_ += other.m2_ + delta * delta * (count_ * (other.count_ / count));
+        } else {
+            mean_ += other.mean_;
+            m2_ = std::numeric_limits<double>::quiet_NaN();
+        }
+        count_ += other.count_;
+    }
+    size_t GetCount() const {
+        return count_;
+    }
+    double GetMean() const {
+        if (count_ == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return mean_;
+    }
+    double GetVariance() const {
+        // Population variance, as in the reported formulas.
+        if (count_ == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return m2_ / count_;
+    }
+};
+
+#endif // MOMENTS_HPP
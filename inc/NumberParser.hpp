@@ -0,0 +1,174 @@
+#ifndef NUMBER_PARSER_HPP
+#define NUMBER_PARSER_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+// Converts a field to double, working on the character range itself.
+//
+// Plain decimals with up to 19 significant digits, whose digits fit in a
+// double exactly and whose power of ten is exact as well (Clinger's fast
+// path), need a single multiplication or division, which IEEE arithmetic
+// rounds correctly. nan and inf tokens are matched directly. Anything
+// else (more digits, large exponents, hex floats, trailing characters) is
+// left to strtod, so results are the same as strtod's for every field.
+class NumberParser {
+public:
+    // Longest field that is passed to strtod without touching the heap.
+    static const size_t kFieldBufferSize = 128;
+
+    static double Parse(const char* begin, const char* end) {
+        // NaN if the field does not start with a number.
+        double value;
+        if (ParseDecimal(begin, end, value) || ParseSpecial(begin, end, value)) {
+            return value;
+        }
+        return ParseSlow(begin, end);
+    }
+
+private:
+    static bool IsDigit(const char c) {
+        return c >= '0' && c <= '9';
+    }
+    static bool ParseDecimal(const char* p, const char* end, double& value) {
+        static const double kPowers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+            1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+            1e21, 1e22
+        };
+        static const uint64_t kIntegerPowers[] = {
+            1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+            10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+            100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+            100000000000000ULL, 1000000000000000ULL
+        };
+        const uint64_t kMaxExact = uint64_t(1) << 53;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            ++p;
+        }
+        // Significant digits, leading zeros left out.
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool found = false;
+        bool fraction = false;
+        for (; p < end; ++p) {
+            if (*p == '.' && ! fraction) {
+                fraction = true;
+                continue;
+            }
+            if (! IsDigit(*p)) {
+                break;
+            }
+            found = true;
+            if (fraction) {
+                --exponent;
+            }
+            if (mantissa == 0 && *p == '0') {
+                continue;
+            }
+            if (++digits > 19) {
+                return false;
+            }
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+        if (! found) {
+            return false;
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            bool negative_exponent = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negative_exponent = *p == '-';
+                ++p;
+            }
+            if (p == end) {
+                return false;
+            }
+            int e = 0;
+            for (; p < end && IsDigit(*p); ++p) {
+                if (e < 10000) {
+                    e = e * 10 + (*p - '0');
+                }
+            }
+            exponent += negative_exponent ? -e : e;
+        }
+        if (p != end) {
+            return false;
+        }
+        if (mantissa == 0) {
+            value = negative ? -0.0 : 0.0;
+            return true;
+        }
+        if (mantissa > kMaxExact) {
+            return false;
+        }
+        if (exponent >= -22 && exponent <= 22) {
+            value = static_cast<double>(mantissa);
+            value = exponent < 0 ? value / kPowers[-exponent] : value * kPowers[exponent];
+        } else if (exponent > 22 && exponent <= 22 + 15 && mantissa <= kMaxExact / kIntegerPowers[exponent - 22]) {
+            // Fewer digits than a double holds; the extra power of ten is
+            // moved into the mantissa, which stays exact.
+            value = static_cast<double>(mantissa * kIntegerPowers[exponent - 22]) * kPowers[22];
+        } else {
+            return false;
+        }
+        value = negative ? -value : value;
+        return true;
+    }
+    static bool Matches(const char* begin, const char* end, const char* word) {
+        // Case insensitive comparison of the whole range.
+        size_t length = std::strlen(word);
+        if (static_cast<size_t>(end - begin) != length) {
+            return false;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if ((begin[i] | 0x20) != word[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static bool ParseSpecial(const char* p, const char* end, double& value) {
+        // nan, inf and infinity, with an optional sign.
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            ++p;
+        }
+        if (Matches(p, end, "nan")) {
+            value = negative ? -std::numeric_limits<double>::quiet_NaN() : std::numeric_limits<double>::quiet_NaN();
+            return true;
+        }
+        if (Matches(p, end, "inf") || Matches(p, end, "infinity")) {
+            value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+            return true;
+        }
+        return false;
+    }
+    static double ParseSlow(const char* begin, const char* end) {
+        char buf[kFieldBufferSize];
+        size_t len = end - begin;
+        if (len >= sizeof(buf)) {
+            return StrToDouble(std::string(begin, end).c_str());
+        }
+        std::memcpy(buf, begin, len);
+        buf[len] = '\0';
+        return StrToDouble(buf);
+    }
+    static double StrToDouble(const char* str) {
+        char* stop = nullptr;
+        double value = std::strtod(str, &stop);
+        if (stop == str) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return value;
+    }
+};
+
+#endif // NUMBER_PARSER_HPP
@@ -5,6 +5,7 @@
 #include <string>
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
 
 class OptionParser {
 private:
@@ -20,7 +21,7 @@ public:
         if (argc > 1) {
             for (int i=1; i<argc; ++i) {
                 std::string argi(argv[i]);
-                if (argi[0] != '-') {
+                if (argi[0] != '-' || argi == "-") {
                     params_.push_back(argi);
                 }
                 else {
@@ -74,6 +75,51 @@ public:
         value = std::stoi(GetString(option));
         return value;
     }
+    bool GetDoubleList(const std::string & option, std::vector<double> & values) {
+        // Comma separated numbers; false if any of them is not a number.
+        std::string list = GetString(option);
+        values.clear();
+        size_t begin = 0;
+        while (begin <= list.size()) {
+            size_t end = list.find(',', begin);
+            if (end == std::string::npos) {
+                end = list.size();
+            }
+            std::string item = list.substr(begin, end - begin);
+            char* item_end = nullptr;
+            double value = std::strtod(item.c_str(), &item_end);
+            if (item.empty() || *item_end != '\0') {
+                return false;
+            }
+            values.push_back(value);
+            begin = end + 1;
+        }
+        return true;
+    }
+    bool GetByteSize(const std::string & option, size_t & bytes) {
+        // Number of bytes, with an optional K, M or G (binary) suffix.
+        std::string value = GetString(option);
+        char* end = nullptr;
+        double number = std::strtod(value.c_str(), &end);
+        if (value.empty() || end == value.c_str() || number < 0.0) {
+            return false;
+        }
+        double scale = 1.0;
+        switch (std::toupper(static_cast<unsigned char>(*end))) {
+        case 'K': scale = 1024.0; ++end; break;
+        case 'M': scale = 1024.0 * 1024.0; ++end; break;
+        case 'G': scale = 1024.0 * 1024.0 * 1024.0; ++end; break;
+        default: break;
+        }
+        if (*end == 'B' || *end == 'b') {
+            ++end;
+        }
+        if (*end != '\0') {
+            return false;
+        }
+        bytes = static_cast<size_t>(number * scale);
+        return true;
+    }
     std::string GetString(const std::string & option) {
         std::string param = option + "=";
         std::string value = "";
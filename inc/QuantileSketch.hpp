@@ -0,0 +1,143 @@
+#ifndef QUANTILE_SKETCH_HPP
+#define QUANTILE_SKETCH_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// KLL quantile sketch: values are kept in levels of compactors, a value at
+// level h standing for 2^h values. A full level is sorted and every other
+// value moves up a level. Level capacities shrink geometrically downwards,
+// so memory stays near kSize / (1 - 2/3) values for any number of values,
+// with a rank error of about 1% of the count. Quantiles are exact until
+// kSize values are added.
+//
+// Values to drop on compaction are chosen by alternating the offset per
+// level instead of at random, so results depend only on the values and the
+// order of additions and merges.
+class QuantileSketch {
+private:
+    static const size_t kSize = 256;
+
+    std::vector<std::vector<double>> levels_;
+    std::vector<uint8_t> offsets_;
+    uint64_t count_;
+    size_t size_;
+    size_t max_size_;
+
+public:
+    QuantileSketch()
+    : count_(0)
+    , size_(0)
+    , max_size_(0)
+    {}
+    ~QuantileSketch() {}
+    void Clear() {
+        levels_.clear();
+        offsets_.clear();
+        count_ = 0;
+        size_ = 0;
+        max_size_ = 0;
+    }
+    uint64_t GetCount() const {
+        return count_;
+    }
+    void Add(const double value) {
+        if (levels_.empty()) {
+            AddLevel();
+        }
+        levels_[0].push_back(value);
+        ++count_;
+        if (++size_ >= max_size_) {
+            Compress();
+        }
+    }
+    void Merge(const QuantileSketch& other) {
+        if (other.count_ == 0) {
+            return;
+        }
+        while (levels_.size() < other.levels_.size()) {
+            AddLevel();
+        }
+        for (size_t h = 0; h < other.levels_.size(); ++h) {
+            levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+        }
+        count_ += other.count_;
+        size_ += other.size_;
+        while (size_ >= max_size_) {
+            Compress();
+        }
+    }
+    double GetQuantile(const double q) const {
+        // Smallest value with at least q of all values at or below it.
+        if (count_ == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        std::vector<std::pair<double, uint64_t>> weighted;
+        weighted.reserve(size_);
+        for (size_t h = 0; h < levels_.size(); ++h) {
+            for (auto value : levels_[h]) {
+                weighted.push_back(std::make_pair(value, uint64_t(1) << h));
+            }
+        }
+        std::sort(weighted.begin(), weighted.end());
+        uint64_t total = 0;
+        for (auto & item : weighted) {
+            total += item.second;
+        }
+        double rank = std::ceil(q * static_cast<double>(total));
+        uint64_t cumulative = 0;
+        for (auto & item : weighted) {
+            cumulative += item.second;
+            if (static_cast<double>(cumulative) >= rank) {
+                return item.first;
+            }
+        }
+        return weighted.back().first;
+    }
+
+private:
+    void AddLevel() {
+        levels_.emplace_back();
+        offsets_.push_back(0);
+        max_size_ = 0;
+        for (size_t h = 0; h < levels_.size(); ++h) {
+            max_size_ += GetCapacity(h);
+        }
+    }
+    size_t GetCapacity(const size_t level) const {
+        // kSize at the top level, 2/3 of the level above below it.
+        double capacity = kSize * std::pow(2.0 / 3.0, static_cast<double>(levels_.size() - 1 - level));
+        return std::max<size_t>(2, static_cast<size_t>(std::ceil(capacity)));
+    }
+    void Compress() {
+        // Compact the lowest level which is over its capacity.
+        for (size_t h = 0; h < levels_.size(); ++h) {
+            if (levels_[h].size() < GetCapacity(h)) {
+                continue;
+            }
+            if (h + 1 == levels_.size()) {
+                AddLevel();
+            }
+            auto & level = levels_[h];
+            std::sort(level.begin(), level.end());
+            // An odd value out stays at this level.
+            size_t begin = level.size() % 2;
+            size_t offset = offsets_[h];
+            offsets_[h] ^= 1;
+            auto & above = levels_[h + 1];
+            for (size_t i = begin + offset; i < level.size(); i += 2) {
+                above.push_back(level[i]);
+            }
+            size_ -= (level.size() - begin) / 2;
+            level.resize(begin);
+            return;
+        }
+    }
+};
+
+#endif // QUANTILE_SKETCH_HPP
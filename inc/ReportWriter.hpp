@@ -0,0 +1,29 @@
+#ifndef REPORT_WRITER_HPP
+#define REPORT_WRITER_HPP
+
+#include "CsvResult.hpp"
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Output format of the report; column results are passed one at a time,
+// between Begin and End.
+class ReportWriter {
+protected:
+    std::ostream& out_;
+
+public:
+    ReportWriter(std::ostream& out)
+    : out_(out)
+    {}
+    virtual ~ReportWriter() {}
+    virtual void Begin(const CsvResultTotals& totals) = 0;
+    virtual void WriteSuggestion(const std::string& /*ref_name*/, const std::string& /*data_name*/) {}
+    virtual void Write(const CsvResult& result) = 0;
+    virtual void End(const CsvResultTotals& /*totals*/) {}
+};
+
+typedef std::unique_ptr<ReportWriter> ReportWriterPtr;
+
+#endif // REPORT_WRITER_HPP
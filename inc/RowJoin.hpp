@@ -0,0 +1,248 @@
+#ifndef ROW_JOIN_HPP
+#define ROW_JOIN_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+// Pairs rows of two files by the values of a key column, one to one. Keys
+// sorted in both files are merge joined, others are hash joined; both run in
+// linear time. With a tolerance, each row is paired with the nearest key
+// within it, for keys which differ slightly, e.g. solver time steps; pairs
+// are the same for either method, and unsorted keys then take O(n log k)
+// for k distinct data keys.
+// Matched pairs are kept in reference row order; NaN keys never match.
+class RowJoin {
+public:
+    enum Method {
+        kNone,
+        kMerge,
+        kHash
+    };
+
+private:
+    static const size_t kNoRow = static_cast<size_t>(-1);
+    std::vector<size_t> ref_rows_;
+    std::vector<size_t> data_rows_;
+    size_t ref_size_;
+    size_t data_size_;
+    Method method_;
+
+public:
+    RowJoin()
+    : ref_size_(0)
+    , data_size_(0)
+    , method_(kNone)
+    {}
+    ~RowJoin() {}
+    void Join(const double* ref_keys, const size_t ref_size, const double* data_keys, const size_t data_size, const double& tolerance) {
+        ref_rows_.clear();
+        data_rows_.clear();
+        ref_size_ = ref_size;
+        data_size_ = data_size;
+        const bool sorted = IsSorted(ref_keys, ref_size) && IsSorted(data_keys, data_size);
+        method_ = sorted ? kMerge : kHash;
+        if (tolerance > 0.0) {
+            NearestJoin(ref_keys, data_keys, tolerance, sorted);
+        } else if (sorted) {
+            MergeJoin(ref_keys, data_keys);
+        } else {
+            HashJoin(ref_keys, data_keys);
+        }
+    }
+    void Clear() {
+        // Free the matched rows, once aligned columns are no longer needed.
+        std::vector<size_t>().swap(ref_rows_);
+        std::vector<size_t>().swap(data_rows_);
+    }
+    Method GetMethod() const {
+        return method_;
+    }
+    const char* GetMethodName() const {
+        return method_ == kMerge ? "merge" : "hash";
+    }
+    size_t GetMatchCount() const {
+        return ref_rows_.size();
+    }
+    size_t GetUnmatchedRefCount() const {
+        return ref_size_ - ref_rows_.size();
+    }
+    size_t GetUnmatchedDataCount() const {
+        return data_size_ - data_rows_.size();
+    }
+    size_t GetRefRow(const size_t match) const {
+        return ref_rows_[match];
+    }
+    size_t GetDataRow(const size_t match) const {
+        return data_rows_[match];
+    }
+    void Gather(const double* values, const size_t size, double* out, const bool data) const {
+        // Copy values of matched rows of one side into contiguous storage;
+        // rows past the end of a short column are NaN.
+        const std::vector<size_t>& rows = data ? data_rows_ : ref_rows_;
+        for (size_t k = 0; k < rows.size(); ++k) {
+            out[k] = rows[k] < size ? values[rows[k]] : std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+private:
+    static bool IsSorted(const double* keys, const size_t size) {
+        // Non-decreasing, without NaN.
+        for (size_t i = 0; i < size; ++i) {
+            if (std::isnan(keys[i]) || (i > 0 && keys[i] < keys[i - 1])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    void AddMatch(const size_t ref_row, const size_t data_row) {
+        ref_rows_.push_back(ref_row);
+        data_rows_.push_back(data_row);
+    }
+    void MergeJoin(const double* ref_keys, const double* data_keys) {
+        // Walk both keys in order; repeated keys are matched in the order
+        // they appear.
+        size_t i = 0;
+        size_t j = 0;
+        while (i < ref_size_ && j < data_size_) {
+            if (data_keys[j] < ref_keys[i]) {
+                ++j;
+            } else if (data_keys[j] > ref_keys[i]) {
+                ++i;
+            } else {
+                AddMatch(i++, j++);
+            }
+        }
+    }
+    void HashJoin(const double* ref_keys, const double* data_keys) {
+        // Data rows with equal keys are chained in row order; repeated keys
+        // are matched in the order they appear.
+        std::vector<size_t> next(data_size_, static_cast<size_t>(kNoRow));
+        std::unordered_map<double, size_t> heads;
+        heads.reserve(data_size_);
+        for (size_t j = data_size_; j-- > 0;) {
+            if (std::isnan(data_keys[j])) {
+                continue;
+            }
+            auto inserted = heads.insert(std::make_pair(data_keys[j], j));
+            if (! inserted.second) {
+                next[j] = inserted.first->second;
+                inserted.first->second = j;
+            }
+        }
+        for (size_t i = 0; i < ref_size_; ++i) {
+            auto it = heads.find(ref_keys[i]);
+            if (it == heads.end() || it->second == kNoRow) {
+                continue;
+            }
+            AddMatch(i, it->second);
+            it->second = next[it->second];
+        }
+    }
+    void NearestJoin(const double* ref_keys, const double* data_keys, const double& tolerance, const bool sorted) {
+        // Each reference row, in row order, takes the nearest data key within
+        // tolerance which has unused rows left; on equal distance the earlier
+        // data row. The rule is the same for sorted and unsorted keys.
+        // Data rows are grouped by key value, each group chained in row order,
+        // and the groups ordered by key: in one pass if keys are sorted, when
+        // the search position only moves forward, else by hashing and sorting,
+        // with a binary search per row. Emptied groups are skipped through
+        // links to their live neighbours.
+        std::vector<size_t> next(data_size_, static_cast<size_t>(kNoRow));
+        std::vector<std::pair<double, size_t> > groups;
+        if (sorted) {
+            size_t last = kNoRow;
+            for (size_t j = 0; j < data_size_; ++j) {
+                if (! std::isfinite(data_keys[j])) {
+                    continue;
+                }
+                if (! groups.empty() && groups.back().first == data_keys[j]) {
+                    next[last] = j;
+                } else {
+                    groups.push_back(std::make_pair(data_keys[j], j));
+                }
+                last = j;
+            }
+        } else {
+            std::unordered_map<double, size_t> heads;
+            heads.reserve(data_size_);
+            for (size_t j = data_size_; j-- > 0;) {
+                if (! std::isfinite(data_keys[j])) {
+                    continue;
+                }
+                auto inserted = heads.insert(std::make_pair(data_keys[j], j));
+                if (! inserted.second) {
+                    next[j] = inserted.first->second;
+                    inserted.first->second = j;
+                }
+            }
+            groups.assign(heads.begin(), heads.end());
+            std::sort(groups.begin(), groups.end());
+        }
+        std::vector<double> keys(groups.size());
+        std::vector<size_t> left(groups.size());
+        std::vector<size_t> right(groups.size());
+        for (size_t g = 0; g < groups.size(); ++g) {
+            keys[g] = groups[g].first;
+            left[g] = right[g] = g;
+        }
+        size_t pos = 0;
+        for (size_t i = 0; i < ref_size_; ++i) {
+            double r = ref_keys[i];
+            if (! std::isfinite(r)) {
+                continue;
+            }
+            if (sorted) {
+                while (pos < keys.size() && keys[pos] < r) {
+                    ++pos;
+                }
+            } else {
+                pos = std::lower_bound(keys.begin(), keys.end(), r) - keys.begin();
+            }
+            size_t below = FindLive(left, pos - 1);
+            size_t above = FindLive(right, pos);
+            size_t best = kNoRow;
+            double best_distance = tolerance;
+            for (size_t g : { below, above }) {
+                if (g >= groups.size()) {
+                    continue;
+                }
+                double distance = std::fabs(keys[g] - r);
+                size_t j = groups[g].second;
+                if (distance < best_distance || (distance == best_distance && (best == kNoRow || j < groups[best].second))) {
+                    best = g;
+                    best_distance = distance;
+                }
+            }
+            if (best == kNoRow) {
+                continue;
+            }
+            size_t& head = groups[best].second;
+            AddMatch(i, head);
+            head = next[head];
+            if (head == kNoRow) {
+                left[best] = best - 1;
+                right[best] = best + 1;
+            }
+        }
+    }
+    static size_t FindLive(std::vector<size_t>& link, size_t g) {
+        // Follow links from g to the nearest group with unused rows, or past
+        // either end, shortening the path on the way back.
+        size_t live = g;
+        while (live < link.size() && link[live] != live) {
+            live = link[live];
+        }
+        while (g != live) {
+            size_t following = link[g];
+            link[g] = live;
+            g = following;
+        }
+        return live;
+    }
+};
+
+#endif // ROW_JOIN_HPP
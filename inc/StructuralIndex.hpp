@@ -0,0 +1,153 @@
+#ifndef STRUCTURAL_INDEX_HPP
+#define STRUCTURAL_INDEX_HPP
+
+#include "DiffKernel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Bitmasks of the commas and whitespace (space, \t, \r) in a line, one bit
+// per character, built 64 characters at a time with SSE2 or AVX2 compares.
+// Field boundaries and trimmed field ends are then found by scanning bits
+// instead of characters. The instruction set is the one selected for the
+// statistics kernel (see DiffKernel, CSVDIFF_SIMD).
+class StructuralIndex {
+private:
+    static const size_t kBlockSize = 64;
+
+    std::vector<uint64_t> commas_;
+    std::vector<uint64_t> spaces_;
+    size_t size_;
+
+public:
+    StructuralIndex()
+    : size_(0)
+    {}
+    ~StructuralIndex() {}
+    void Build(const char* begin, const size_t size) {
+        // Index size characters; bits past the end are clear.
+        const size_t words = (size + kBlockSize - 1) / kBlockSize;
+        if (commas_.size() < words) {
+            commas_.resize(words);
+            spaces_.resize(words);
+        }
+        size_ = size;
+        const DiffKernel::Target target = DiffKernel::GetTarget();
+        size_t w = 0;
+        for (; (w + 1) * kBlockSize <= size; ++w) {
+            BuildBlock(target, begin + w * kBlockSize, commas_[w], spaces_[w]);
+        }
+        if (w < words) {
+            // Zero padded copy of the last, partial block.
+            char block[kBlockSize] = {};
+            std::memcpy(block, begin + w * kBlockSize, size - w * kBlockSize);
+            BuildBlock(target, block, commas_[w], spaces_[w]);
+        }
+    }
+    size_t NextComma(const size_t from) const {
+        // Position of the first comma at or after from, size if none.
+        return FindFirst(commas_, from, size_, false);
+    }
+    size_t FirstNonSpace(const size_t from, const size_t to) const {
+        // First position in [from, to) which is not whitespace, to if none.
+        return FindFirst(spaces_, from, to, true);
+    }
+    size_t LastNonSpace(const size_t from, const size_t to) const {
+        // Last position in [from, to) which is not whitespace, to if none.
+        return FindLast(spaces_, from, to, true);
+    }
+    bool HasSpace(const size_t from, const size_t to) const {
+        return FindFirst(spaces_, from, to, false) < to;
+    }
+
+private:
+    static uint64_t Word(const std::vector<uint64_t>& bits, const size_t w, const bool invert) {
+        return invert ? ~bits[w] : bits[w];
+    }
+    static size_t FindFirst(const std::vector<uint64_t>& bits, const size_t from, const size_t to, const bool invert) {
+        if (from >= to) {
+            return to;
+        }
+        size_t w = from / kBlockSize;
+        uint64_t word = Word(bits, w, invert) & (~uint64_t(0) << (from % kBlockSize));
+        const size_t last = (to - 1) / kBlockSize;
+        while (word == 0) {
+            if (++w > last) {
+                return to;
+            }
+            word = Word(bits, w, invert);
+        }
+        size_t pos = w * kBlockSize + __builtin_ctzll(word);
+        return pos < to ? pos : to;
+    }
+    static size_t FindLast(const std::vector<uint64_t>& bits, const size_t from, const size_t to, const bool invert) {
+        if (from >= to) {
+            return to;
+        }
+        size_t w = (to - 1) / kBlockSize;
+        uint64_t word = Word(bits, w, invert) & (~uint64_t(0) >> (kBlockSize - 1 - (to - 1) % kBlockSize));
+        const size_t first = from / kBlockSize;
+        while (word == 0) {
+            if (w-- == first) {
+                return to;
+            }
+            word = Word(bits, w, invert);
+        }
+        size_t pos = w * kBlockSize + 63 - __builtin_clzll(word);
+        return pos >= from ? pos : to;
+    }
+    static void BuildBlock(const DiffKernel::Target target, const char* p, uint64_t& commas, uint64_t& spaces) {
+        switch (target) {
+#ifdef DIFF_KERNEL_X86
+            case DiffKernel::kAvx512:
+            case DiffKernel::kAvx2: BuildAvx2(p, commas, spaces); return;
+            case DiffKernel::kSse2: BuildSse2(p, commas, spaces); return;
+#endif
+            default: BuildScalar(p, commas, spaces); return;
+        }
+    }
+    static void BuildScalar(const char* p, uint64_t& commas, uint64_t& spaces) {
+        commas = spaces = 0;
+        for (size_t i = 0; i < kBlockSize; ++i) {
+            const uint64_t bit = uint64_t(1) << i;
+            if (p[i] == ',') {
+                commas |= bit;
+            } else if (p[i] == ' ' || p[i] == '\t' || p[i] == '\r') {
+                spaces |= bit;
+            }
+        }
+    }
+#ifdef DIFF_KERNEL_X86
+    static void BuildSse2(const char* p, uint64_t& commas, uint64_t& spaces) {
+        const __m128i v_comma = _mm_set1_epi8(',');
+        const __m128i v_space = _mm_set1_epi8(' ');
+        const __m128i v_tab = _mm_set1_epi8('\t');
+        const __m128i v_cr = _mm_set1_epi8('\r');
+        commas = spaces = 0;
+        for (size_t k = 0; k < 4; ++k) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+            __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, v_space), _mm_or_si128(_mm_cmpeq_epi8(v, v_tab), _mm_cmpeq_epi8(v, v_cr)));
+            commas |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, v_comma)))) << (16 * k);
+            spaces |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(space))) << (16 * k);
+        }
+    }
+    __attribute__((target("avx2")))
+    static void BuildAvx2(const char* p, uint64_t& commas, uint64_t& spaces) {
+        const __m256i v_comma = _mm256_set1_epi8(',');
+        const __m256i v_space = _mm256_set1_epi8(' ');
+        const __m256i v_tab = _mm256_set1_epi8('\t');
+        const __m256i v_cr = _mm256_set1_epi8('\r');
+        commas = spaces = 0;
+        for (size_t k = 0; k < 2; ++k) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * k));
+            __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, v_space), _mm256_or_si256(_mm256_cmpeq_epi8(v, v_tab), _mm256_cmpeq_epi8(v, v_cr)));
+            commas |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, v_comma)))) << (32 * k);
+            spaces |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(space))) << (32 * k);
+        }
+    }
+#endif
+};
+
+#endif // STRUCTURAL_INDEX_HPP
@@ -0,0 +1,85 @@
+#ifndef TEXT_REPORT_WRITER_HPP
+#define TEXT_REPORT_WRITER_HPP
+
+#include "ReportWriter.hpp"
+
+#include <cstdio>
+
+// Table of column statistics, for the terminal.
+class TextReportWriter : public ReportWriter {
+public:
+    TextReportWriter(std::ostream& out)
+    : ReportWriter(out)
+    {}
+    ~TextReportWriter() {}
+    void Begin(const CsvResultTotals& totals) override {
+        char buf[1024];
+        snprintf(buf, sizeof(buf), "Epsilon = %g\n", totals.eps);
+        out_ << buf << "\n";
+        snprintf(buf, sizeof(buf)
+            , "%-32s : %20s %20s %20s %20s %20s %20s"
+            , "Variable (ref)"
+            , "Max"
+            , "Min"
+            , "Mean"
+            , "SD"
+            , "Mean (abs)"
+            , "SD (abs)"
+        );
+        out_ << buf;
+        for (auto p : totals.percentiles) {
+            char label[32];
+            snprintf(label, sizeof(label), "P%g (abs)", p);
+            snprintf(buf, sizeof(buf), " %20s", label);
+            out_ << buf;
+        }
+        out_ << "\n";
+    }
+    void Write(const CsvResult& result) override {
+        char buf[1024];
+        if (result.status == CsvResult::kSame) {
+            snprintf(buf, sizeof(buf), "%-32s : Values are same", result.name.c_str());
+            out_ << buf;
+        } else if (result.status == CsvResult::kNan) {
+            snprintf(buf, sizeof(buf), "%-32s : NaN values in column!", result.name.c_str());
+            out_ << buf;
+        } else {
+            snprintf(buf, sizeof(buf)
+                , "%-32s : %20g %20g %20g %20g %20g %20g"
+                , result.name.c_str()
+                , result.max
+                , result.min
+                , result.mean
+                , result.sd
+                , result.mean_abs
+                , result.sd_abs
+            );
+            out_ << buf;
+            for (auto value : result.percentiles) {
+                snprintf(buf, sizeof(buf), " %20g", value);
+                out_ << buf;
+            }
+        }
+        out_ << "\n";
+        for (auto & row : result.top) {
+            snprintf(buf, sizeof(buf)
+                , "%32s   row %zu : Ref(%.15g) Data(%.15g), |diff| = %g"
+                , ""
+                , row.row + 1
+                , row.ref
+                , row.data
+                , row.diff_abs
+            );
+            out_ << buf;
+            if (row.data_row != row.row) {
+                out_ << ", data row " << row.data_row + 1;
+            }
+            out_ << "\n";
+        }
+    }
+    void End(const CsvResultTotals& /*totals*/) override {
+        out_ << "\n";
+    }
+};
+
+#endif // TEXT_REPORT_WRITER_HPP
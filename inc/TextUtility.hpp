@@ -3,9 +3,17 @@
 
 #include <string>
 #include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 
 class TextUtility {
 public:
+    // Longest pattern for the bit-parallel edit distance, one machine word.
+    static const size_t kMaxPatternLength = 64;
+
     static const std::string Strip(const std::string& str, const std::string& chars=" \t\r") {     
         std::string result("");
         for(auto & c : str) {
@@ -16,24 +24,95 @@ public:
         }
         return result;
     }
-    static const int LevenshteinDistance(const std::string& s1, const std::string& s2) {
-        // Calculate Levenshtein distance between two strings.
-        int l1 = s1.length();
-        int l2 = s2.length();
-        std::vector<std::vector<int>> matrix(l1 + 1, std::vector<int>(l2 + 1));
-        for (int i = 0; i <= l1; ++i) {
-            matrix[i][0] = i;
+    static const int LevenshteinDistance(const std::string& s1, const std::string& s2, const int limit=INT_MAX) {
+        // Calculate Levenshtein distance between two strings; any value above
+        // limit is returned as limit + 1, which allows an early exit.
+        const std::string& pattern = s1.size() <= s2.size() ? s1 : s2;
+        const std::string& text = s1.size() <= s2.size() ? s2 : s1;
+        if (pattern.size() > kMaxPatternLength) {
+            return BandedDistance(pattern, text, limit);
+        }
+        uint64_t peq[256];
+        SetPattern(pattern, peq);
+        return MyersDistance(peq, pattern.size(), text, limit);
+    }
+    static void SetPattern(const std::string& pattern, uint64_t* peq) {
+        // Bit mask of the positions of each character in the pattern.
+        std::memset(peq, 0, 256 * sizeof(uint64_t));
+        for (size_t i = 0; i < pattern.size() && i < kMaxPatternLength; ++i) {
+            peq[static_cast<unsigned char>(pattern[i])] |= uint64_t(1) << i;
+        }
+    }
+    static const int MyersDistance(const uint64_t* peq, const size_t length, const std::string& text, const int limit=INT_MAX) {
+        // Bit-parallel edit distance (Myers, Hyyro): one column of the
+        // distance matrix per text character, for patterns up to 64 long.
+        const int m = static_cast<int>(length);
+        const int n = static_cast<int>(text.size());
+        if (std::abs(m - n) > limit) {
+            return limit + 1;
+        }
+        if (m == 0) {
+            return n;
+        }
+        const uint64_t last = uint64_t(1) << (m - 1);
+        uint64_t pv = ~uint64_t(0);
+        uint64_t mv = 0;
+        int score = m;
+        for (int j = 0; j < n; ++j) {
+            uint64_t eq = peq[static_cast<unsigned char>(text[j])];
+            uint64_t xv = eq | mv;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+            if (ph & last) {
+                ++score;
+            } else if (mh & last) {
+                --score;
+            }
+            // Score drops by at most one per remaining character.
+            if (score - (n - 1 - j) > limit) {
+                return limit + 1;
+            }
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+        }
+        return score;
+    }
+    static const int BandedDistance(const std::string& s1, const std::string& s2, const int limit=INT_MAX) {
+        // Edit distance over the diagonal band |i - j| <= limit only, two rows
+        // at a time; stops as soon as a whole row is above limit.
+        const int l1 = static_cast<int>(s1.size());
+        const int l2 = static_cast<int>(s2.size());
+        if (std::abs(l1 - l2) > limit) {
+            return limit + 1;
         }
-        for (int j = 0; j <= l2; ++j) {
-            matrix[0][j] = j;
+        const int k = std::min(limit, std::max(l1, l2));
+        const int inf = k + 1;
+        std::vector<int> prev(l2 + 2, inf);
+        std::vector<int> cur(l2 + 2, inf);
+        for (int j = 0; j <= std::min(l2, k); ++j) {
+            prev[j] = j;
         }
         for (int i = 1; i <= l1; ++i) {
-            for (int j = 1; j <= l2; ++j) {
+            const int lo = std::max(1, i - k);
+            const int hi = std::min(l2, i + k);
+            cur[lo - 1] = (lo == 1 && i <= k) ? i : inf;
+            int row_min = cur[lo - 1];
+            for (int j = lo; j <= hi; ++j) {
                 int cost = (s1[i - 1] == s2[j - 1]) ? 0 : 1;
-                matrix[i][j] = std::min({matrix[i - 1][j] + 1, matrix[i][j - 1] + 1, matrix[i - 1][j - 1] + cost});
+                int value = std::min({prev[j - 1] + cost, prev[j] + 1, cur[j - 1] + 1});
+                cur[j] = std::min(value, inf);
+                row_min = std::min(row_min, cur[j]);
+            }
+            cur[hi + 1] = inf;
+            if (row_min > k) {
+                return limit + 1;
             }
+            prev.swap(cur);
         }
-        return matrix[l1][l2];
+        return prev[l2] <= k ? prev[l2] : limit + 1;
     }
 };
 
@@ -0,0 +1,135 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+private:
+    typedef std::function<void()> Task;
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    // One queue per worker; idle workers steal from the others.
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    size_t queued_;
+    size_t pending_;
+    size_t next_queue_;
+    bool stop_;
+
+public:
+    ThreadPool(size_t threads)
+    : queued_(0)
+    , pending_(0)
+    , next_queue_(0)
+    , stop_(false)
+    {
+        if (threads == 0) {
+            threads = DefaultThreads();
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            queues_.push_back(std::make_unique<TaskQueue>());
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this, i]{ WorkerLoop(i); });
+        }
+    }
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto & worker : workers_) {
+            worker.join();
+        }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    static size_t DefaultThreads() {
+        size_t threads = std::thread::hardware_concurrency();
+        return threads > 0 ? threads : 1;
+    }
+    size_t GetSize() const {
+        return workers_.size();
+    }
+    void Submit(Task task) {
+        // Distribute tasks round robin; order of submission is order of preference.
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            index = next_queue_;
+            next_queue_ = (next_queue_ + 1) % queues_.size();
+            ++queued_;
+            ++pending_;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+            queues_[index]->tasks.push_back(std::move(task));
+        }
+        work_cv_.notify_one();
+    }
+    void Wait() {
+        // Block until all submitted tasks are finished.
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]{ return pending_ == 0; });
+    }
+    template <typename Fun>
+    void ParallelFor(const size_t count, Fun&& fun) {
+        // Run fun(i) for i in [0, count) and wait for all of them.
+        for (size_t i = 0; i < count; ++i) {
+            Submit([&fun, i]{ fun(i); });
+        }
+        Wait();
+    }
+
+private:
+    bool PopTask(const size_t id, Task& task) {
+        // Own queue first, then steal from the others; oldest task first in both.
+        for (size_t k = 0; k < queues_.size(); ++k) {
+            auto & queue = *queues_[(id + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+    void WorkerLoop(const size_t id) {
+        for (;;) {
+            Task task;
+            if (PopTask(id, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    --queued_;
+                }
+                task();
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--pending_ == 0) {
+                    done_cv_.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this]{ return stop_ || queued_ > 0; });
+            if (stop_ && queued_ == 0) {
+                return;
+            }
+        }
+    }
+};
+
+#endif // THREAD_POOL_HPP
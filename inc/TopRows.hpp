@@ -0,0 +1,108 @@
+#ifndef TOP_ROWS_HPP
+#define TOP_ROWS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// The K rows of a column with the largest absolute differences, kept in a
+// bounded min-heap. Rows with a NaN difference rank above all others; equal
+// differences go to the earlier row, so merged results do not depend on how
+// rows were split.
+class TopRows {
+public:
+    struct Row {
+        size_t row;
+        // Row of the data file; differs from row only for rows paired by key.
+        size_t data_row;
+        double ref;
+        double data;
+        double diff_abs;
+    };
+
+private:
+    size_t size_;
+    // Heap with the lowest ranked row in front.
+    std::vector<Row> heap_;
+
+public:
+    TopRows()
+    : size_(0)
+    {}
+    ~TopRows() {}
+    void SetSize(const size_t size) {
+        size_ = size;
+        heap_.clear();
+        heap_.reserve(size);
+    }
+    size_t GetSize() const {
+        return size_;
+    }
+    void Clear() {
+        heap_.clear();
+    }
+    static bool Before(const Row& a, const Row& b) {
+        // True if row a ranks above row b.
+        if (std::isnan(a.diff_abs) != std::isnan(b.diff_abs)) {
+            return std::isnan(a.diff_abs);
+        }
+        if (a.diff_abs != b.diff_abs && ! std::isnan(a.diff_abs)) {
+            return a.diff_abs > b.diff_abs;
+        }
+        return a.row < b.row;
+    }
+    bool CanSkip(const double max_diff_abs, const bool has_nan) const {
+        // True if no row of a later block, with the given largest difference,
+        // can enter the heap.
+        if (heap_.size() < size_) {
+            return false;
+        }
+        const double lowest = heap_.front().diff_abs;
+        return std::isnan(lowest) || (! has_nan && max_diff_abs <= lowest);
+    }
+    void Add(const size_t row, const double ref_value, const double data_value, const double eps) {
+        // Difference as calculated for the statistics; rows within epsilon are skipped.
+        double diff_abs = 0.0;
+        if (! (std::isnan(ref_value) && std::isnan(data_value))) {
+            diff_abs = std::fabs(ref_value - data_value);
+        }
+        if (diff_abs < eps || diff_abs == 0.0) {
+            return;
+        }
+        Insert(Row{ row, row, ref_value, data_value, diff_abs });
+    }
+    void AddValues(const size_t first_row, const double* ref_values, const double* data_values, const size_t size, const double eps) {
+        for (size_t i = 0; i < size; ++i) {
+            Add(first_row + i, ref_values[i], data_values[i], eps);
+        }
+    }
+    void Merge(const TopRows& other) {
+        for (auto & row : other.heap_) {
+            Insert(row);
+        }
+    }
+    std::vector<Row> GetRows() const {
+        // Rows from the largest difference down.
+        std::vector<Row> rows(heap_);
+        std::sort(rows.begin(), rows.end(), Before);
+        return rows;
+    }
+
+private:
+    void Insert(const Row& row) {
+        if (size_ == 0) {
+            return;
+        }
+        if (heap_.size() < size_) {
+            heap_.push_back(row);
+            std::push_heap(heap_.begin(), heap_.end(), Before);
+        } else if (Before(row, heap_.front())) {
+            std::pop_heap(heap_.begin(), heap_.end(), Before);
+            heap_.back() = row;
+            std::push_heap(heap_.begin(), heap_.end(), Before);
+        }
+    }
+};
+
+#endif // TOP_ROWS_HPP